@@ -6,89 +6,46 @@
  * SPDX-License-Identifier: MPL-2.0
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
-#include <opencv2/imgproc/imgproc.hpp>
-#include <link_dev/Interfaces/OpenCvToImage.h>
 #include "baslercamdriver.h"
+#include "frameconverter.h"
+#include "pylonframesource.h"
+#include "replayframesource.h"
+#include "streamfanout.h"
+#include "syntheticframesource.h"
+#include "telemetry.h"
+#include "workerpool.h"
+#include "CameraControl_generated.h"
 #include "GenericMatrix3D_generated.h"
 #include "Image_generated.h"
+#include "RawImage_generated.h"
+#include "StampedImage_generated.h"
 
-using namespace Basler_GigECameraParams;
-
-void setUpCameraForAutoFunctions(Pylon::CBaslerGigEInstantCamera& camera, uint64_t frameWidth,
-                                 int64_t frameHeight)
-{
-    camera.Width.SetValue(frameWidth);
-    camera.Height.SetValue(frameHeight);
-
-    // Set the Auto Function AOI for luminance statistics.
-    // Currently, AutoFunctionAOISelector_AOI1 is predefined to gather
-    // luminance statistics.
-                    
-    camera.AutoFunctionAOISelector.SetValue(AutoFunctionAOISelector_AOI1);
-
-    camera.AutoFunctionAOIOffsetX.SetValue(camera.OffsetX.GetMin());
-    camera.AutoFunctionAOIOffsetY.SetValue(camera.OffsetY.GetMin());
-    camera.AutoFunctionAOIWidth.SetValue(camera.Width.GetMax());
-    camera.AutoFunctionAOIHeight.SetValue(camera.Height.GetMax());
-    
-    return;
-}
-
-void AutoGainOnce(Pylon::CBaslerGigEInstantCamera& camera)
-{
-    // Check whether the gain auto function is available.
-    if(!IsWritable(camera.GainAuto))
-    {
-        std::cout << "The camera does not support Gain Auto." << std::endl << std::endl;
-        return;
-    }
-    std::cout << "Initial Gain = " << camera.GainRaw.GetValue() << std::endl;
-    // Set the gain ranges for luminance control.
-    camera.AutoGainRawLowerLimit.SetValue(camera.GainRaw.GetMin());
-    camera.AutoGainRawUpperLimit.SetValue(camera.GainRaw.GetMax());
-
-    // When the "once" mode of operation is selected,
-    // the parameter values are automatically adjusted until the related image property
-    // reaches the target value. After the automatic parameter value adjustment is complete, the auto
-    // function will automatically be set to "off" and the new parameter value will be applied to the
-    // subsequently grabbed images.
-    camera.GainAuto.SetValue(GainAuto_Once);
-    std::cout << "Final Gain = " << camera.GainRaw.GetValue() << std::endl << std::endl;
-    return;
-}
-
-void AutoGainContinuous(Pylon::CBaslerGigEInstantCamera& camera)
+/*
+    Sets a binning or decimation factor on the sensor if the camera has the feature and accepts
+    the factor. Returns the factor that is in effect, 1 leaves the work to the host.
+*/
+uint32_t applySensorFactor(GenApi::INodeMap& nodemap, const char* name, uint32_t factor)
 {
-    // Check whether the Gain Auto feature is available.
-    if ( !IsWritable( camera.GainAuto))
+    Pylon::CIntegerParameter parameter(nodemap, name);
+    if(!parameter.IsWritable())
     {
-        std::cout << "The camera does not support Gain Auto." << std::endl;
-        return;
+        return 1;
     }
-
-    // When "continuous" mode is selected, the parameter value is adjusted repeatedly while images are acquired.
-    // Depending on the current frame rate, the automatic adjustments will usually be carried out for
-    // every or every other image unless the camera's micro controller is kept busy by other tasks.
-    // The repeated automatic adjustment will proceed until the "once" mode of operation is used or
-    // until the auto function is set to "off", in which case the parameter value resulting from the latest
-    // automatic adjustment will operate unless the value is manually adjusted.
-    camera.GainAuto.SetValue(GainAuto_Continuous);
-    return;
-}
-
-void AutoExposureContinuous(Pylon::CBaslerGigEInstantCamera& camera)
-{
-    // Check whether the Exposure Auto feature is available.
-    if(!IsWritable(camera.ExposureAuto))
+    if(factor > 1 && (int64_t) factor >= parameter.GetMin() && (int64_t) factor <= parameter.GetMax())
     {
-        std::cout << "The camera does not support Exposure Auto." << std::endl;
-        return;
+        parameter.SetValue(factor);
+        return factor;
     }
-
-    camera.ExposureAuto.SetValue(ExposureAuto_Continuous);
-    return;
+    // Do not inherit a factor a previous session left behind.
+    parameter.TrySetValue(1);
+    return 1;
 }
 
 void BaslerCamConfigEvents::OnOpened(Pylon::CInstantCamera& camera)
@@ -104,14 +61,54 @@ void BaslerCamConfigEvents::OnOpened(Pylon::CInstantCamera& camera)
         Pylon::CIntegerParameter offsetX(nodemap, "OffsetX");
         Pylon::CIntegerParameter offsetY(nodemap, "OffsetY");
         Pylon::CFloatParameter frameRate(nodemap, "AcquisitionFrameRateAbs");
-        Pylon::CFloatParameter resultingFrameRate(nodemap, "ResultingFrameRateAbs");
         
+        // Binning and decimation first, they change the range of the AOI parameters.
+        SensorReduction& sensor = *m_sensorReduction;
+        sensor.binningX = applySensorFactor(nodemap, "BinningHorizontal", m_roi.binning);
+        sensor.binningY = applySensorFactor(nodemap, "BinningVertical", m_roi.binning);
+        sensor.decimationX = applySensorFactor(nodemap, "DecimationHorizontal", m_roi.decimation);
+        sensor.decimationY = applySensorFactor(nodemap, "DecimationVertical", m_roi.decimation);
+        if(sensor.binningX > 1 || sensor.binningY > 1)
+        {
+            // Average like the host does, instead of summing up into saturation.
+            Pylon::CEnumParameter(nodemap, "BinningModeHorizontal").TrySetValue("Averaging");
+            Pylon::CEnumParameter(nodemap, "BinningModeVertical").TrySetValue("Averaging");
+        }
+
+        // From here on the AOI is counted in binned and decimated pixels.
+        uint64_t factorX = sensor.binningX * sensor.decimationX;
+        uint64_t factorY = sensor.binningY * sensor.decimationY;
+
         // Maximize the Image AOI.
         offsetX.TrySetToMinimum(); // Set to minimum if writable.
         offsetY.TrySetToMinimum(); // Set to minimum if writable.
         
-        height.SetValue(m_frameHeight);
-        width.SetValue(m_frameWidth);
+        height.SetValue(m_frameHeight / factorY, Pylon::IntegerValueCorrection_Nearest);
+        width.SetValue(m_frameWidth / factorX, Pylon::IntegerValueCorrection_Nearest);
+
+        sensor.offsetApplied = true;
+        if(m_roi.offsetX != 0 || m_roi.offsetY != 0)
+        {
+            if(offsetX.IsWritable() && offsetY.IsWritable())
+            {
+                offsetX.SetValue(m_roi.offsetX / (int64_t) factorX, Pylon::IntegerValueCorrection_Nearest);
+                offsetY.SetValue(m_roi.offsetY / (int64_t) factorY, Pylon::IntegerValueCorrection_Nearest);
+            }
+            else
+            {
+                // Grab the whole sensor and crop on the host.
+                sensor.offsetApplied = false;
+                width.SetToMaximum();
+                height.SetToMaximum();
+            }
+        }
+
+        // Without this the camera runs as fast as exposure and bandwidth allow.
+        Pylon::CBooleanParameter(nodemap, "AcquisitionFrameRateEnable").TrySetValue(true);
+        if(frameRate.IsWritable())
+        {
+            frameRate.SetValue((double) m_frameRate, Pylon::FloatValueCorrection_ClipToRange);
+        }
     }
     catch (const Pylon::GenericException& e)
     {
@@ -120,239 +117,703 @@ void BaslerCamConfigEvents::OnOpened(Pylon::CInstantCamera& camera)
     return;
 }
 
-void printCameraDetails(Pylon::CBaslerGigEInstantCamera& camera)
+std::string offerNameForCamera(const std::string& offerName, size_t cameraIndex)
 {
-    std::cout << "FullName: " <<  camera.GetDeviceInfo().GetFullName() << std::endl;
-    std::cout << "FriendlyName: " <<  camera.GetDeviceInfo().GetFriendlyName() << std::endl;
-    std::cout << "UserDefinedName:  " <<  camera.GetDeviceInfo().GetUserDefinedName() << std::endl;
-    std::cout << "InternalName: " <<  camera.GetDeviceInfo().GetInternalName() << std::endl;
-    std::cout << "ModelName: " <<  camera.GetDeviceInfo().GetModelName() << std::endl;
-    std::cout << "SerialNumber: " <<  camera.GetDeviceInfo().GetSerialNumber() << std::endl;
-    std::cout << std::endl;
-    return;
+    return cameraIndex == 0 ? offerName : offerName + std::to_string(cameraIndex);
+}
+
+// Output formats that are published as RawImage instead of Image.
+bool isRawOutputFormat(const std::string& outputFormat)
+{
+    return outputFormat.compare("BAYER_U8") == 0 || outputFormat.compare("BAYER_U16") == 0 ||
+           outputFormat.compare("GRAY_U16") == 0;
+}
+
+link_dev::basler::CfaPattern cfaPatternOf(SourcePixelFormat format, BayerPattern pattern)
+{
+    if(!isBayer(format))
+    {
+        return link_dev::basler::CfaPattern_None;
+    }
+    switch(pattern)
+    {
+        case BayerPattern::BG: return link_dev::basler::CfaPattern_BG;
+        case BayerPattern::GB: return link_dev::basler::CfaPattern_GB;
+        case BayerPattern::GR: return link_dev::basler::CfaPattern_GR;
+        case BayerPattern::RG: return link_dev::basler::CfaPattern_RG;
+    }
+    return link_dev::basler::CfaPattern_None;
 }
 
 /*
-    Iterates over list of connected cameras and opens the camera for acquisition if camera 
-    with same camera ID is found. 
+    Opens the frame source of one camera and grabs from it until the node is asked to terminate.
+    Runs on its own thread for every camera in CameraID.
 */
-void createCameraBySerialNrAndGrab(std:: string serialNr, uint64_t frameWidth, 
-                                   uint64_t frameHeight, uint64_t frameRate, 
-                                   bool autoExposure,
-                                   bool autoGain, 
-                                   std::string autoFuntionProfile,
-                                   DRAIVE::Link2::OutputPin outputPin,
-                                   Pylon::WaitObjects waitObjectsContainer,
-                                   int64_t networkInterface,
-                                   std::string outputFormat)
+void createCameraBySerialNrAndGrab(BaslerCamSettings settings,
+                                   size_t cameraIndex,
+                                   DRAIVE::Link2::OutputPin& outputPin,
+                                   std::mutex& outputPinMutex,
+                                   FrameSetAssembler* frameSetAssembler,
+                                   CameraTelemetry& telemetry,
+                                   ControlMailbox& controlMailbox,
+                                   Pylon::WaitObjectEx terminateWaitObj)
 {
-    Pylon::CTlFactory& tlFactory = Pylon::CTlFactory::GetInstance();
-    Pylon::PylonAutoInitTerm autoInitTerm;
-    Pylon::CTlFactory& TlFactory = Pylon::CTlFactory::GetInstance();
-    Pylon::DeviceInfoList_t lstDevices;
-    TlFactory.EnumerateDevices(lstDevices);
-    Pylon::CGrabResultPtr ptrGrabResult;
-    
-    std::cout << "Number of devices found: " << lstDevices.size() << std::endl;
-
-    if(!lstDevices.empty()) 
-    {
-        Pylon::DeviceInfoList_t::const_iterator it;
-        for(it = lstDevices.begin(); it != lstDevices.end(); ++it )
-        {
-            std::stringstream ss;
-            ss << it->GetSerialNumber();
-            std::string name = ss.str();
-            if(serialNr.compare(name) == 0)
+    if(!settings.grabThreadAffinity.empty())
+    {
+        int core = settings.grabThreadAffinity[cameraIndex % settings.grabThreadAffinity.size()];
+        if(!pinCurrentThreadToCore(core))
+        {
+            std::cerr << "Could not pin the grab thread of camera " << cameraIndex << " to core " << core << "." << std::endl;
+        }
+    }
+
+    const std::string imageOfferName = offerNameForCamera("BaslerCamImage", cameraIndex);
+    const std::string compressedOfferName = offerNameForCamera("BaslerCamCompressed", cameraIndex);
+    const std::string rawOfferName = offerNameForCamera("BaslerCamRaw", cameraIndex);
+    const std::string stampedImageOfferName = offerNameForCamera("BaslerCamStampedImage", cameraIndex);
+
+    try
+    {
+        std::unique_ptr<FrameSource> source;
+        if(settings.frameSource.compare("Synthetic") == 0)
+        {
+            SyntheticSourceSettings syntheticSettings;
+            syntheticSettings.width = (uint32_t) settings.frameWidth;
+            syntheticSettings.height = (uint32_t) settings.frameHeight;
+            syntheticSettings.frameRate = (double) settings.frameRate;
+            syntheticSettings.replayFile = settings.syntheticReplayFile;
+            source.reset(new SyntheticFrameSource(syntheticSettings, terminateWaitObj));
+        }
+        else if(settings.frameSource.compare("Replay") == 0)
+        {
+            ReplaySettings replaySettings = settings.replay;
+            replaySettings.file = recordingFileForCamera(replaySettings.file, cameraIndex);
+            source.reset(new ReplayFrameSource(replaySettings, terminateWaitObj));
+        }
+        else
+        {
+            source.reset(new PylonFrameSource(settings, cameraIndex, terminateWaitObj, controlMailbox.postedWaitObject()));
+        }
+
+        link_dev::Format image_format = link_dev::Format_GRAY_U8;
+        ColorOrder color_order = ColorOrder::RGB;
+        SourcePixelFormat source_format = SourcePixelFormat::Mono8;
+
+        if(settings.outputFormat.compare("RGB_U8") == 0)
+        {
+            image_format = link_dev::Format_RGB_U8;
+            color_order = ColorOrder::RGB;
+            source_format = SourcePixelFormat::Bayer8;
+        }
+        else if(settings.outputFormat.compare("BGR_U8") == 0)
+        {
+            image_format = link_dev::Format_BGR_U8;
+            color_order = ColorOrder::BGR;
+            source_format = SourcePixelFormat::Bayer8;
+        }
+        else if(settings.outputFormat.compare("BAYER_U8") == 0)
+        {
+            // Goes through the node like GRAY_U8 does, only the message differs.
+            source_format = SourcePixelFormat::Bayer8;
+        }
+        else if(settings.outputFormat.compare("BAYER_U16") == 0)
+        {
+            source_format = SourcePixelFormat::BayerPacked;
+        }
+        else if(settings.outputFormat.compare("GRAY_U16") == 0)
+        {
+            source_format = SourcePixelFormat::MonoPacked;
+        }
+        bool raw = isRawOutputFormat(settings.outputFormat);
+
+        bool compress = settings.compression.codec != Codec::None;
+        if(compress && frameSetAssembler != nullptr)
+        {
+            std::cerr << "Compression is not available together with FrameSetBundling, publishing uncompressed frame sets." << std::endl;
+            compress = false;
+        }
+        if(compress && raw)
+        {
+            std::cerr << "Compression is not available for raw output formats." << std::endl;
+            compress = false;
+        }
+        bool publishUncompressed = !compress || settings.compression.publishUncompressed;
+        if(compress && !publishUncompressed && image_format == link_dev::Format_RGB_U8)
+        {
+            // Nobody sees the uncompressed image, so demosaic straight into the order the encoder takes.
+            image_format = link_dev::Format_BGR_U8;
+            color_order = ColorOrder::BGR;
+        }
+
+        source->start(source_format);
+        BayerPattern bayer_pattern = source->bayerPattern();
+        uint32_t bit_depth = source->bitDepth();
+        link_dev::basler::CfaPattern cfa_pattern = cfaPatternOf(source_format, bayer_pattern);
+
+        // Again whenever a control parameter changed the frame size.
+        auto hostReduction = [&settings, &source, source_format]()
+        {
+            SoftwareReduction softwareReduction = softwareReductionFor(settings.roi,
+                                                                       (uint32_t) settings.frameWidth,
+                                                                       (uint32_t) settings.frameHeight,
+                                                                       source->sensorReduction());
+            if(isPacked(source_format) && FrameReducer(softwareReduction, isBayer(source_format)).active())
             {
-                try
-                {        
-                    //We found our camera. Create a camera device which we can 
-                    //use to grab images and so forth.
-                    Pylon::CBaslerGigEInstantCamera camera(tlFactory.CreateDevice(*it));
-                    camera.RegisterConfiguration(new BaslerCamConfigEvents(frameWidth,
-                                                                           frameHeight,
-                                                                           frameRate,
-                                                                           autoGain), 
-                                                     Pylon::RegistrationMode_ReplaceAll,
-                                                     Pylon::Cleanup_Delete);
-
-                    printCameraDetails(camera);
-                    //Initialize wait objects. 
-                    waitObjectsContainer.Add(camera.GetGrabResultWaitObject());
-
-                    camera.Open();
-                    camera.MaxNumBuffer = NUMBER_OF_BUFFERS_FOR_GRAB_ENGINE;
-
-                    GenApi::INodeMap& nodemap = camera.GetNodeMap();
-
-                    try {
-                        Pylon::CIntegerParameter(nodemap, "GevSCPSPacketSize").SetValue(networkInterface);
-                    }
-                    catch (const Pylon::GenericException& e)
-                    {
-                        throw RUNTIME_EXCEPTION("Could not apply configuration. const GenericException caught  msg=%hs", e.what());
-                    }
-                    
-                    if(autoExposure || autoGain)
-                    {
-                        setUpCameraForAutoFunctions(camera, frameWidth, frameHeight);
-
-                        if(autoGain)
-                        {
-                            if(autoFuntionProfile.compare("MinimizeGain") == 0)
-                            {
-                                camera.AutoFunctionProfile.SetValue(AutoFunctionProfile_GainMinimum);
-                            }    
-                            AutoGainContinuous(camera);        
-                        }
-
-                        if(autoExposure)
-                        {
-                            if(autoFuntionProfile.compare("MinimizeExposure") == 0)
-                            {
-                                camera.AutoFunctionProfile.SetValue(AutoFunctionProfile_ExposureMinimum);
-                            } 
-                            AutoExposureContinuous(camera);
-                        }
-                    }
+                std::cerr << "The camera cannot do all of the region of interest, binning and decimation, "
+                          << "and packed frames are not reduced on the host. Publishing them as they are." << std::endl;
+                softwareReduction = SoftwareReduction();
+            }
+            return softwareReduction;
+        };
+        FrameReducer reducer(hostReduction(), isBayer(source_format));
+        if(reducer.active())
+        {
+            std::cout << "The camera cannot do all of the region of interest, binning and decimation, the rest is done on the host." << std::endl;
+        }
 
-                    bool terminate = false;
-                    unsigned int index;
-                    
-                    link_dev::Format image_format;
-                    cv::ColorConversionCodes color_conversion_code;
+        Demosaicer demosaicer(settings.demosaicQuality, color_order, settings.demosaicInstructionSet);
+        if(image_format != link_dev::Format_GRAY_U8)
+        {
+            std::cout << "Demosaicing with " << instructionSetName(demosaicer.instructionSet()) << " kernels." << std::endl;
+        }
 
-                    if(outputFormat.compare("RGB_U8") == 0)
-                    {
-                        Pylon::CEnumParameter(nodemap, "PixelFormat").SetValue("BayerBG8");
-                        image_format = link_dev::Format_RGB_U8;
-                        color_conversion_code = cv::COLOR_BayerBG2RGB;
-                    }
-                    else if(outputFormat.compare("BGR_U8") == 0)
-                    {
-                        Pylon::CEnumParameter(nodemap, "PixelFormat").SetValue("BayerBG8");
-                        image_format = link_dev::Format_BGR_U8;
-                        color_conversion_code = cv::COLOR_BayerBG2BGR;
-                    }
-                    else if(outputFormat.compare("GRAY_U8") == 0)
-                    {
-                        Pylon::CEnumParameter(nodemap, "PixelFormat").SetValue("Mono8");
-                        image_format = link_dev::Format_GRAY_U8;
-                    }
+        std::unique_ptr<Unpacker> unpacker;
+        if(isPacked(source_format))
+        {
+            unpacker.reset(new Unpacker(bit_depth, settings.demosaicInstructionSet));
+            std::cout << "Unpacking " << bit_depth << " bit pixels with " << instructionSetName(unpacker->instructionSet()) << " kernels." << std::endl;
+        }
+        const Unpacker* packedUnpacker = unpacker.get();
 
-                    camera.StartGrabbing(Pylon::GrabStrategy_OneByOne); 
-                    bool frameDropErrorOccurredOnce = false;
+        WorkerPool conversionPool(settings.conversionThreads, settings.conversionThreadAffinity);
 
-                    while(camera.IsGrabbing() && terminate == false)
-                    {
-                        if(!waitObjectsContainer.WaitForAny(0xFFFFFFFF, &index))
-                        {
-                            std::cout << "This should not happen. Check wait Objects." << std::endl;
-                            break;
-                        }
-
-                        switch(index)
-                        {
-                            case 0:  // Received a termination request
-                            {
-                                terminate = true;
-                                break;
-                            }
-                            case 1:  // A grabbed buffer is available
-                            {
-                                // All triggered images are still waiting in the output queue
-                                // and will now be retrieved.
-                                // Don't wait for timeout. We want good FPS. If it works, it works. 
-                                // This smart pointer will receive the grab result data.
-                                //camera.GetGrabResultWaitObject().Wait(0);
-                                if(camera.RetrieveResult(0, ptrGrabResult, Pylon::TimeoutHandling_Return)) 
-                                {
-                                    if(ptrGrabResult->GrabSucceeded())
-                                    {
-                                        if(outputFormat.compare("GRAY_U8") == 0)
-                                        {
-                                            uint8_t *pImageBuffer = (uint8_t *) ptrGrabResult->GetBuffer();
-                                            cv::Size imageSize(frameWidth, frameHeight);
-                                            cv::Mat frame(imageSize, CV_8UC1, pImageBuffer);
-                                            link_dev::ImageT currentImage =
-                                            link_dev::Interfaces::ImageFromOpenCV(frame, link_dev::Format_GRAY_U8);   
-                                            outputPin.push(currentImage, "BaslerCamImage");
-                                        }
-                                        else
-                                        {
-                                            cv::Mat converted;
-                                            uint8_t *pImageBuffer = (uint8_t *) ptrGrabResult->GetBuffer();
-                                            cv::Size imageSize(frameWidth, frameHeight);
-                                            cv::Mat frame(imageSize, CV_8UC1, pImageBuffer);
-                                            cvtColor(frame, converted, color_conversion_code);    
-                                            link_dev::ImageT currentImage =
-                                            link_dev::Interfaces::ImageFromOpenCV(converted, image_format);   
-                                            outputPin.push(currentImage, "BaslerCamImage");
-                                        }
-                                    }
-                                    else
-                                    {
-                                        if(!frameDropErrorOccurredOnce)
-                                        {
-                                            std::cerr << "Error: " << ptrGrabResult->GetErrorCode() << " " << ptrGrabResult->GetErrorDescription() << "\n\n" << "Further warnings will be supressed." << std::endl;
-                                            frameDropErrorOccurredOnce = true;
-                                        }
-                                    }
-                                }
-                                break;
-                            }
-                            default: 
-                            {
-                                break;
-                            }
-                        } 
-                    }
+        // One buffer for every image that can be in flight: in the publish queue and the one
+        // being published, waiting for or inside an encoder, or waiting for a frame set.
+        size_t numberOfImageBuffers = settings.pipeline.enabled ? settings.pipeline.publishQueueDepth + 2 : 1;
+        if(compress)
+        {
+            numberOfImageBuffers += settings.compression.queueDepth + settings.compression.threads;
+        }
+        if(frameSetAssembler != nullptr)
+        {
+            numberOfImageBuffers += FRAME_SET_REORDER_DEPTH;
+        }
+        numberOfImageBuffers += FRAME_BUFFER_POOL_SPARE;
+        auto imageSize = [&settings, &source, image_format, &demosaicer, &reducer, packedUnpacker]()
+        {
+            SensorReduction sensorReduction = source->sensorReduction();
+            uint32_t sourceWidth = (uint32_t) settings.frameWidth / (sensorReduction.binningX * sensorReduction.decimationX);
+            uint32_t sourceHeight = (uint32_t) settings.frameHeight / (sensorReduction.binningY * sensorReduction.decimationY);
+            return convertedImageSize(sourceWidth, sourceHeight, image_format, demosaicer, reducer, packedUnpacker);
+        };
+        FrameBufferPool bufferPool(numberOfImageBuffers, imageSize(), settings.hugePageBuffers);
+
+        auto convert = [image_format, &demosaicer, &bayer_pattern, &reducer, packedUnpacker, &bufferPool, &conversionPool](RawFrame& rawFrame, ConvertedFrame& convertedFrame)
+        {
+            convertedFrame.info.convertStart = steadyClockNs();
+            bool converted = convertFrame(rawFrame, convertedFrame, image_format, demosaicer, bayer_pattern, reducer, packedUnpacker,
+                                          bufferPool, conversionPool);
+            convertedFrame.info.convertEnd = steadyClockNs();
+            return converted;
+        };
+        std::unique_ptr<FrameEncoder> encoder;
+        if(compress)
+        {
+            encoder.reset(new FrameEncoder(settings.compression,
+                                           [&outputPin, &outputPinMutex, &compressedOfferName](link_dev::basler::CompressedImageT& compressedImage)
+                                           {
+                                               std::lock_guard<std::mutex> lock(outputPinMutex);
+                                               outputPin.push(compressedImage, compressedOfferName);
+                                           }));
+        }
+
+        std::vector<std::string> streamOfferNames;
+        std::unique_ptr<StreamFanOut> fanOut;
+        if(!settings.streams.empty() && raw)
+        {
+            std::cerr << "Streams are not available for raw output formats." << std::endl;
+        }
+        else if(!settings.streams.empty())
+        {
+            for(size_t stream = 0; stream < settings.streams.size(); stream++)
+            {
+                streamOfferNames.push_back(offerNameForCamera(std::string("BaslerCamStream") + (char) ('A' + stream), cameraIndex));
+            }
+            fanOut.reset(new StreamFanOut(settings.streams, image_format,
+                                          [&outputPin, &outputPinMutex, &streamOfferNames](size_t stream, link_dev::ImageT& image)
+                                          {
+                                              std::lock_guard<std::mutex> lock(outputPinMutex);
+                                              outputPin.push(image, streamOfferNames[stream]);
+                                          }));
+        }
+
+        // With ChunkMetadata the image goes out together with its metadata instead of on its own.
+        // The message is reused for every frame, the image is only moved in for the push.
+        const bool stamped = settings.chunkMetadata;
+        link_dev::basler::StampedImageT stampedImage;
+        stampedImage.image.reset(new link_dev::ImageT());
+        stampedImage.metadata.reset(new link_dev::basler::FrameMetadata());
 
-                    ptrGrabResult.Release();
-                    camera.StopGrabbing();
+        auto publish = [&outputPin, &outputPinMutex, &imageOfferName, &rawOfferName, &stampedImageOfferName, frameSetAssembler, cameraIndex,
+                        &telemetry, publishUncompressed, &encoder, raw, &cfa_pattern, bit_depth, &fanOut, stamped, &stampedImage](ConvertedFrame& convertedFrame)
+        {
+            FrameInfo info = convertedFrame.info;
+            info.publishStart = steadyClockNs();
+            if(fanOut)
+            {
+                // Before the frame is handed on, the streams read it in place.
+                fanOut->process(convertedFrame.image);
+            }
+            if(frameSetAssembler != nullptr)
+            {
+                // The set is pushed by whichever camera completes it, so Publish
+                // includes that push for the last camera and is short for the others.
+                frameSetAssembler->add(cameraIndex, std::move(convertedFrame));
+            }
+            else if(raw)
+            {
+                link_dev::basler::RawImageT rawImage;
+                rawImage.camera_timestamp = info.cameraTimestamp;
+                rawImage.width = convertedFrame.image.width;
+                rawImage.height = convertedFrame.image.height;
+                rawImage.cfa_pattern = cfa_pattern;
+                rawImage.bit_depth = (uint8_t) bit_depth;
+                if(info.hasChunks)
+                {
+                    rawImage.metadata.reset(new link_dev::basler::FrameMetadata(frameMetadataOf(info)));
                 }
-                catch(const Pylon::GenericException &e)
+
+                // The pixels are only borrowed for the push, a lent grab buffer has to go back
+                // through the ConvertedFrame.
+                rawImage.data.swap(convertedFrame.image.data);
+                try
                 {
-                    std::cerr << "An exception occurred." << std::endl
-                    << e.GetDescription() << std::endl;
+                    std::lock_guard<std::mutex> lock(outputPinMutex);
+                    outputPin.push(rawImage, rawOfferName);
                 }
+                catch(...)
+                {
+                    convertedFrame.image.data.swap(rawImage.data);
+                    throw;
+                }
+                convertedFrame.image.data.swap(rawImage.data);
             }
             else
             {
-                std::cerr << "No devices found!" << std::endl;
-                return;
+                if(publishUncompressed && stamped)
+                {
+                    *stampedImage.metadata = frameMetadataOf(info);
+                    *stampedImage.image = std::move(convertedFrame.image);
+                    try
+                    {
+                        std::lock_guard<std::mutex> lock(outputPinMutex);
+                        outputPin.push(stampedImage, stampedImageOfferName);
+                    }
+                    catch(...)
+                    {
+                        convertedFrame.image = std::move(*stampedImage.image);
+                        throw;
+                    }
+                    convertedFrame.image = std::move(*stampedImage.image);
+                }
+                else if(publishUncompressed)
+                {
+                    std::lock_guard<std::mutex> lock(outputPinMutex);
+                    outputPin.push(convertedFrame.image, imageOfferName);
+                }
+                if(encoder)
+                {
+                    // Publish only covers handing the frame over, encoding happens on the encoder threads.
+                    encoder->submit(std::move(convertedFrame));
+                }
             }
+            telemetry.recordPublished(info, steadyClockNs());
+        };
+
+        // Every frame in flight in the pipeline holds on to one of the grab engine's buffers.
+        size_t grabBuffers = source->grabBuffers();
+        if(settings.pipeline.enabled && grabBuffers > 0 &&
+           settings.pipeline.convertQueueDepth + 1 >= grabBuffers)
+        {
+            std::cerr << "Warning: ConvertQueueDepth leaves the grab engine with too few buffers." << std::endl;
+        }
+
+        std::unique_ptr<FrameRecorder> recorder;
+        if(!settings.recording.file.empty())
+        {
+            RecordingSettings recordingSettings = settings.recording;
+            recordingSettings.file = recordingFileForCamera(recordingSettings.file, cameraIndex);
+            recorder.reset(new FrameRecorder(recordingSettings, source_format, bayer_pattern, bit_depth));
+        }
+
+        // Only called once the pipeline is empty, so nothing converts or publishes meanwhile.
+        GrabControl grabControl;
+        grabControl.mailbox = &controlMailbox;
+        grabControl.frameSizeChanged = [&](const std::vector<ControlParameter>& parameters)
+        {
+            for(const ControlParameter& parameter : parameters)
+            {
+                applyControlParameter(settings, parameter);
+            }
+            bayer_pattern = source->bayerPattern();
+            cfa_pattern = cfaPatternOf(source_format, bayer_pattern);
+            reducer = FrameReducer(hostReduction(), isBayer(source_format));
+            bufferPool.grow(imageSize());
+        };
+
+        runGrabLoop(*source, settings.pipeline, convert, publish, telemetry, recorder.get(), &grabControl);
+        // Frames still waiting for an encoder, the disk or a frame set hold grab buffers or pooled
+        // buffers, which have to go back first.
+        encoder.reset();
+        recorder.reset();
+        if(frameSetAssembler != nullptr)
+        {
+            frameSetAssembler->discardPending(cameraIndex);
+        }
+        source->stop();
+    }
+    catch(const Pylon::GenericException &e)
+    {
+        std::cerr << "An exception occurred." << std::endl
+        << e.GetDescription() << std::endl;
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+
+/*
+    Triggers all cameras configured with TriggerSource ActionCommand at the same instant, at the
+    configured frame rate, until the node is asked to terminate. A new rate from the control pin
+    takes effect from the next trigger on.
+*/
+void BaslerCamDriver::issueActionCommands()
+{
+    Pylon::IGigETransportLayer* transportLayer = dynamic_cast<Pylon::IGigETransportLayer*>(
+        Pylon::CTlFactory::GetInstance().CreateTl(Pylon::BaslerGigEDeviceClass));
+    if(transportLayer == nullptr)
+    {
+        std::cerr << "No GigE transport layer, cannot issue action commands." << std::endl;
+        return;
+    }
+
+    auto nextTrigger = std::chrono::steady_clock::now();
+
+    for(;;)
+    {
+        nextTrigger += std::chrono::nanoseconds(1000000000ull / std::max<uint64_t>(m_actionCommandRate.load(std::memory_order_relaxed), 1));
+        // Sleep through whole milliseconds on the wait object so that termination still gets
+        // through, then the rest precisely, so that no trigger is issued early.
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(nextTrigger - std::chrono::steady_clock::now());
+        if(m_terminateWaitObj.Wait((unsigned int) std::max<int64_t>(remaining.count(), 0)))
+        {
+            break;
+        }
+        std::this_thread::sleep_until(nextTrigger);
+        transportLayer->IssueActionCommand(ACTION_DEVICE_KEY, ACTION_GROUP_KEY, ACTION_GROUP_MASK);
+    }
+
+    Pylon::CTlFactory::GetInstance().ReleaseTl(transportLayer);
+}
+
+/*
+    Collects the telemetry of all cameras every TelemetryIntervalMs and publishes it on
+    BaslerCamTelemetry until the node is asked to terminate.
+*/
+void BaslerCamDriver::publishTelemetry(std::vector<std::unique_ptr<CameraTelemetry>>& telemetry)
+{
+    int64_t intervalStart = steadyClockNs();
+
+    while(!m_terminateWaitObj.Wait((unsigned int) m_settings.telemetryIntervalMs))
+    {
+        int64_t intervalEnd = steadyClockNs();
+        double intervalSeconds = (intervalEnd - intervalStart) / 1e9;
+        intervalStart = intervalEnd;
+
+        link_dev::basler::TelemetryT message;
+        message.timestamp = (uint64_t) intervalEnd;
+        message.interval_ms = (uint32_t) m_settings.telemetryIntervalMs;
+        for(std::unique_ptr<CameraTelemetry>& cameraTelemetry : telemetry)
+        {
+            message.cameras.push_back(cameraTelemetry->collect(intervalSeconds));
+        }
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_outputPinMutex);
+            m_outputPin.push(message, "BaslerCamTelemetry");
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Publishing telemetry failed: " << e.what() << std::endl;
         }
     }
 }
 
+/*
+    Takes one CameraControl message off the control pin and hands its parameters to the grab
+    threads of the cameras it addresses. A message with a parameter that cannot be applied is
+    ignored as a whole.
+*/
+void BaslerCamDriver::receiveControl(std::vector<std::unique_ptr<ControlMailbox>>& mailboxes)
+{
+    link_dev::basler::CameraControlT control;
+    try
+    {
+        control = m_controlPin.receive<link_dev::basler::CameraControlT>("BaslerCamControl");
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "Receiving a control message failed: " << e.what() << std::endl;
+        return;
+    }
+
+    // Checked here, so that the grab threads only ever see parameters they can apply.
+    BaslerCamSettings checkedSettings = m_settings;
+    std::vector<ControlParameter> parameters;
+    bool frameRateChanged = false;
+    for(const std::unique_ptr<link_dev::basler::ControlParameterT>& parameter : control.parameters)
+    {
+        ControlParameter controlParameter{parameter->name, parameter->value};
+        frameRateChanged = frameRateChanged || controlParameter.name.compare("FrameRate") == 0;
+        try
+        {
+            applyControlParameter(checkedSettings, controlParameter);
+        }
+        catch(const std::invalid_argument& e)
+        {
+            std::cerr << "Ignoring control message: " << e.what() << std::endl;
+            return;
+        }
+        parameters.push_back(controlParameter);
+    }
+
+    bool addressed = false;
+    for(size_t cameraIndex = 0; cameraIndex < m_settings.cameraIDs.size(); cameraIndex++)
+    {
+        if(control.serial_number.empty() || control.serial_number.compare(m_settings.cameraIDs[cameraIndex]) == 0)
+        {
+            mailboxes[cameraIndex]->post(parameters);
+            addressed = true;
+        }
+    }
+    if(!addressed)
+    {
+        std::cerr << "Ignoring control message for unknown camera " << control.serial_number << "." << std::endl;
+        return;
+    }
+
+    // The cameras follow the action commands, not their own frame rate. They are triggered
+    // together, so the rate is the same for all of them.
+    if(frameRateChanged && m_settings.sync.triggerSource.compare("ActionCommand") == 0)
+    {
+        m_actionCommandRate.store(checkedSettings.frameRate, std::memory_order_relaxed);
+        std::cout << "Issuing action commands at " << checkedSettings.frameRate << " fps." << std::endl;
+    }
+}
+
+Pylon::EGrabStrategy grabStrategyFromString(const std::string& grabStrategy)
+{
+    if(grabStrategy.compare("OneByOne") == 0) return Pylon::GrabStrategy_OneByOne;
+    if(grabStrategy.compare("LatestImageOnly") == 0) return Pylon::GrabStrategy_LatestImageOnly;
+    if(grabStrategy.compare("LatestImages") == 0) return Pylon::GrabStrategy_LatestImages;
+    if(grabStrategy.compare("UpcomingImage") == 0) return Pylon::GrabStrategy_UpcomingImage;
+    throw std::invalid_argument("Unknown grab strategy: " + grabStrategy);
+}
 
 int BaslerCamDriver::run() 
 {
     Pylon::PylonInitialize();
-    
-    std::thread cameraGrabber(createCameraBySerialNrAndGrab, m_cameraID,
-                                                             m_frameWidth,
-                                                             m_frameHeight,
-                                                             m_frameRate,
-                                                             m_autoExposure,
-                                                             m_autoGain,
-                                                             m_autoFunctionProfile,
-                                                             m_outputPin,
-                                                             m_waitObjectsContainer,
-                                                             m_NetworkInterfaceMTU,
-                                                             m_outputFormat);
-
-    while(m_signalHandler.receiveSignal() != LINK2_SIGNAL_INTERRUPT); 
-
-    //Allow the cameraGrabber thread to finish.
+
+    bool frameSetBundling = m_settings.sync.frameSetBundling;
+    if(frameSetBundling && isRawOutputFormat(m_settings.outputFormat))
+    {
+        std::cerr << "FrameSetBundling is not available for raw output formats, publishing per camera." << std::endl;
+        frameSetBundling = false;
+    }
+
+    std::unique_ptr<FrameSetAssembler> frameSetAssembler;
+    if(frameSetBundling)
+    {
+        if(!m_settings.sync.ptp)
+        {
+            std::cout << "PtpSync is off, frame sets are matched by the time the frames arrived on the host." << std::endl;
+        }
+        frameSetAssembler.reset(new FrameSetAssembler(m_settings.cameraIDs,
+                                                      m_settings.sync.frameSetToleranceUs * 1000,
+                                                      m_settings.sync.ptp,
+                                                      [this](link_dev::basler::FrameSetT& frameSet)
+                                                      {
+                                                          std::lock_guard<std::mutex> lock(m_outputPinMutex);
+                                                          m_outputPin.push(frameSet, "BaslerCamFrameSet");
+                                                      }));
+    }
+
+    std::vector<std::unique_ptr<CameraTelemetry>> telemetry;
+    for(const std::string& cameraID : m_settings.cameraIDs)
+    {
+        telemetry.push_back(std::unique_ptr<CameraTelemetry>(new CameraTelemetry(cameraID)));
+    }
+
+    std::vector<std::unique_ptr<ControlMailbox>> controlMailboxes;
+    for(size_t cameraIndex = 0; cameraIndex < m_settings.cameraIDs.size(); cameraIndex++)
+    {
+        controlMailboxes.push_back(std::unique_ptr<ControlMailbox>(new ControlMailbox()));
+    }
+
+    std::vector<std::thread> cameraGrabbers;
+    for(size_t cameraIndex = 0; cameraIndex < m_settings.cameraIDs.size(); cameraIndex++)
+    {
+        cameraGrabbers.push_back(std::thread(createCameraBySerialNrAndGrab, m_settings,
+                                                                            cameraIndex,
+                                                                            std::ref(m_outputPin),
+                                                                            std::ref(m_outputPinMutex),
+                                                                            frameSetAssembler.get(),
+                                                                            std::ref(*telemetry[cameraIndex]),
+                                                                            std::ref(*controlMailboxes[cameraIndex]),
+                                                                            m_terminateWaitObj));
+    }
+
+    std::thread actionCommandIssuer;
+    if(m_settings.sync.triggerSource.compare("ActionCommand") == 0)
+    {
+        actionCommandIssuer = std::thread(&BaslerCamDriver::issueActionCommands, this);
+    }
+
+    std::thread telemetryPublisher;
+    if(m_settings.telemetryIntervalMs > 0)
+    {
+        telemetryPublisher = std::thread(&BaslerCamDriver::publishTelemetry, this, std::ref(telemetry));
+    }
+
+    // Every signal but the interrupt is a control message.
+    while(m_signalHandler.receiveSignal() != LINK2_SIGNAL_INTERRUPT)
+    {
+        receiveControl(controlMailboxes);
+    }
+
+    //Allow the cameraGrabber threads to finish.
     m_terminateWaitObj.Signal();
 
-    cameraGrabber.join();
+    if(actionCommandIssuer.joinable())
+    {
+        actionCommandIssuer.join();
+    }
+    if(telemetryPublisher.joinable())
+    {
+        telemetryPublisher.join();
+    }
+    for(std::thread& cameraGrabber : cameraGrabbers)
+    {
+        cameraGrabber.join();
+    }
 
     std::cout << "Kill Signal received. Terminating... " << std::endl;
     Pylon::PylonTerminate();
 
     return 0;
 }
+
+// Whole numbers only, std::stoull alone would take "-1" and "30fps".
+uint64_t controlValueToUInt(const std::string& value, uint64_t minimum, uint64_t maximum)
+{
+    size_t parsed = 0;
+    if(value.empty() || value[0] == '-')
+    {
+        throw std::invalid_argument(value);
+    }
+    uint64_t number = std::stoull(value, &parsed);
+    if(parsed != value.size() || number < minimum || number > maximum)
+    {
+        throw std::invalid_argument(value);
+    }
+    return number;
+}
+
+bool controlValueToBoolean(const std::string& value)
+{
+    if(value.compare("true") == 0) return true;
+    if(value.compare("false") == 0) return false;
+    throw std::invalid_argument(value);
+}
+
+ControlEffect applyControlParameter(BaslerCamSettings& settings, const ControlParameter& parameter)
+{
+    const std::string& name = parameter.name;
+    const std::string& value = parameter.value;
+    try
+    {
+        if(name.compare("FrameRate") == 0)
+        {
+            settings.frameRate = controlValueToUInt(value, 1, UINT32_MAX);
+            return ControlEffect::Live;
+        }
+        if(name.compare("AutoExposureContinuous") == 0)
+        {
+            settings.autoExposure = controlValueToBoolean(value);
+            return ControlEffect::Live;
+        }
+        if(name.compare("AutoGainContinuous") == 0)
+        {
+            settings.autoGain = controlValueToBoolean(value);
+            return ControlEffect::Live;
+        }
+        if(name.compare("AutoFunctionProfile") == 0)
+        {
+            if(value.compare("MinimizeGain") != 0 && value.compare("MinimizeExposure") != 0 && value.compare("Off") != 0)
+            {
+                throw std::invalid_argument(value);
+            }
+            settings.autoFunctionProfile = value;
+            return ControlEffect::Live;
+        }
+        if(name.compare("ExposureTimeUs") == 0)
+        {
+            settings.exposureTimeUs = controlValueToUInt(value, 0, UINT32_MAX);
+            return ControlEffect::Live;
+        }
+        if(name.compare("GainRaw") == 0)
+        {
+            settings.gainRaw = value.compare("-1") == 0 ? -1 : (int64_t) controlValueToUInt(value, 0, INT32_MAX);
+            return ControlEffect::Live;
+        }
+        if(name.compare("ImageWidth") == 0)
+        {
+            settings.frameWidth = controlValueToUInt(value, 1, UINT32_MAX);
+            return ControlEffect::FrameSize;
+        }
+        if(name.compare("ImageHeight") == 0)
+        {
+            settings.frameHeight = controlValueToUInt(value, 1, UINT32_MAX);
+            return ControlEffect::FrameSize;
+        }
+        if(name.compare("OffsetX") == 0)
+        {
+            settings.roi.offsetX = (int64_t) controlValueToUInt(value, 0, INT32_MAX);
+            return ControlEffect::FrameSize;
+        }
+        if(name.compare("OffsetY") == 0)
+        {
+            settings.roi.offsetY = (int64_t) controlValueToUInt(value, 0, INT32_MAX);
+            return ControlEffect::FrameSize;
+        }
+        if(name.compare("Binning") == 0)
+        {
+            settings.roi.binning = (uint32_t) controlValueToUInt(value, 1, 4);
+            return ControlEffect::FrameSize;
+        }
+        if(name.compare("Decimation") == 0)
+        {
+            settings.roi.decimation = (uint32_t) controlValueToUInt(value, 1, 8);
+            return ControlEffect::FrameSize;
+        }
+    }
+    catch(const std::logic_error&)
+    {
+        // std::invalid_argument and std::out_of_range, also from std::stoull.
+        throw std::invalid_argument("Invalid value \"" + value + "\" for " + name + ".");
+    }
+    throw std::invalid_argument(name + " cannot be changed while grabbing.");
+}
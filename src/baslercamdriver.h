@@ -8,7 +8,11 @@
 #ifndef BASLERCAMDRIVER_HPP
 #define BASLERCAMDRIVER_HPP
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <stdexcept>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -18,20 +22,93 @@
 #include <pylon/TlFactory.h>
 #include <pylon/DeviceFactory.h> 
 #include <pylon/gige/BaslerGigEInstantCamera.h>
+#include <pylon/gige/GigETransportLayer.h>
 #include <pylon/ConfigurationEventHandler.h>
 
 #include <DRAIVE/Link2/NodeDiscovery.hpp>
 #include <DRAIVE/Link2/NodeResources.hpp>
 #include <DRAIVE/Link2/SignalHandler.hpp>
 #include <DRAIVE/Link2/ConfigurationNode.hpp>
+#include <DRAIVE/Link2/InputPin.hpp>
 #include <DRAIVE/Link2/OutputPin.hpp>
 
+#include "cameracontrol.h"
+#include "configcache.h"
+#include "demosaic.h"
+#include "frameencoder.h"
+#include "framepipeline.h"
+#include "framerecorder.h"
+#include "framereducer.h"
+#include "framesetassembler.h"
+#include "gigetransport.h"
+#include "replayframesource.h"
+#include "streamfanout.h"
+#include "telemetry.h"
+
 #define DEFAULT_FRAME_WIDTH 640
 #define DEFAULT_FRAME_HEIGHT 480
 #define DEFAULT_FRAME_RATE 24
 #define DEFAULT_LUMINANCE_CONTROL 100
 #define NUMBER_OF_BUFFERS_FOR_GRAB_ENGINE 50
 #define DEFAULT_PACKET_SIZE 1500
+#define UPCOMING_IMAGE_TIMEOUT_MS 1000
+#define MAX_NUMBER_OF_CAMERAS 8
+#define ACTION_DEVICE_KEY 0x4C444E43
+#define ACTION_GROUP_KEY 1
+#define ACTION_GROUP_MASK 0xFFFFFFFF
+#define PTP_LOCK_TIMEOUT_MS 10000
+#define DEFAULT_HEARTBEAT_TIMEOUT_MS 1000
+
+struct SyncSettings
+{
+    bool ptp = false;
+    std::string triggerSource = "FreeRun";
+    bool frameSetBundling = false;
+    uint64_t frameSetToleranceUs = DEFAULT_FRAME_SET_TOLERANCE_US;
+};
+
+struct BaslerCamSettings
+{
+    std::vector<std::string> cameraIDs;
+    // "Camera", "Synthetic" for test frames that need no camera (see SyntheticFrameSource),
+    // or "Replay" to play back a recording (see ReplayFrameSource).
+    std::string frameSource = "Camera";
+    std::string syntheticReplayFile = "";
+    std::vector<int> grabThreadAffinity;
+    uint64_t frameWidth = DEFAULT_FRAME_WIDTH;
+    uint64_t frameHeight = DEFAULT_FRAME_HEIGHT;
+    uint64_t frameRate = DEFAULT_FRAME_RATE;
+    RoiSettings roi;
+    Pylon::EGrabStrategy grabStrategy = Pylon::GrabStrategy_OneByOne;
+    size_t outputQueueSize = 1;
+    size_t grabBufferCount = NUMBER_OF_BUFFERS_FOR_GRAB_ENGINE;
+    bool autoExposure = true, autoGain = false;
+    std::string autoFunctionProfile = "";
+    // While the auto function is off. 0 and -1 keep what the camera has.
+    uint64_t exposureTimeUs = 0;
+    int64_t gainRaw = -1;
+    int64_t networkInterfaceMTU = DEFAULT_PACKET_SIZE;
+    ConfigCacheSettings configCache;
+    uint64_t heartbeatTimeoutMs = DEFAULT_HEARTBEAT_TIMEOUT_MS;
+    TransportSettings transport;
+    std::string outputFormat = "";
+    DemosaicQuality demosaicQuality = DemosaicQuality::Bilinear;
+    InstructionSet demosaicInstructionSet = InstructionSet::Scalar;
+    size_t conversionThreads = 1;
+    std::vector<int> conversionThreadAffinity;
+    bool hugePageBuffers = false;
+    PipelineSettings pipeline;
+    CompressionSettings compression;
+    std::vector<StreamSettings> streams;
+    RecordingSettings recording;
+    ReplaySettings replay;
+    // Timestamp, exposure time, gain and frame counter appended to every frame by the camera.
+    bool chunkMetadata = false;
+    // How often the camera clock is read to map its timestamps to the host clock, 0 never.
+    uint64_t clockSyncIntervalMs = 0;
+    SyncSettings sync;
+    uint64_t telemetryIntervalMs = DEFAULT_TELEMETRY_INTERVAL_MS;
+};
 
 class BaslerCamDriver : public Pylon::CConfigurationEventHandler
 {
@@ -39,70 +116,86 @@ class BaslerCamDriver : public Pylon::CConfigurationEventHandler
     DRAIVE::Link2::NodeResources m_nodeResources;
     DRAIVE::Link2::NodeDiscovery m_nodeDiscovery;
     DRAIVE::Link2::OutputPin m_outputPin;
+    DRAIVE::Link2::InputPin m_controlPin;
  
 public:
-    std::string m_cameraID = "";
-    uint64_t m_frameWidth = DEFAULT_FRAME_WIDTH;
-    uint64_t m_frameHeight = DEFAULT_FRAME_HEIGHT;
-    uint64_t m_frameRate = DEFAULT_FRAME_RATE;
-    bool m_autoExposure = true, m_autoGain = false;
-    std::string m_autoFunctionProfile = "";
-    int64_t m_NetworkInterfaceMTU = DEFAULT_PACKET_SIZE;
-    std::string m_outputFormat = "";
+    BaslerCamSettings m_settings;
     Pylon::WaitObjectEx m_terminateWaitObj;
-    Pylon::WaitObjects m_waitObjectsContainer;
+    // The cameras share one output pin, pushes from their grab threads are serialized.
+    std::mutex m_outputPinMutex;
 
     BaslerCamDriver(DRAIVE::Link2::SignalHandler signalHandler,
                     DRAIVE::Link2::NodeResources nodeResources,
                     DRAIVE::Link2::NodeDiscovery nodeDiscovery,
                     DRAIVE::Link2::OutputPin outputPin,
-                    std::string cameraID,
-                    uint64_t frameWidth, 
-                    uint64_t frameHeight,
-                    uint64_t frameRate,
-                    bool autoExposure,
-                    bool autoGain,
-                    std::string autoFunctionProfile,
-                    int64_t networkInterfaceMTU,
-                    std::string outputFormat
+                    DRAIVE::Link2::InputPin controlPin,
+                    BaslerCamSettings settings
                     ) :
                     m_signalHandler(signalHandler),
                     m_nodeResources(nodeResources),
                     m_nodeDiscovery(nodeDiscovery),
                     m_outputPin(outputPin),
-                    m_cameraID(cameraID),
-                    m_frameWidth(frameWidth),
-                    m_frameHeight(frameHeight),
-                    m_frameRate(frameRate),
-                    m_autoExposure(autoExposure),
-                    m_autoGain(autoGain),
-                    m_autoFunctionProfile(autoFunctionProfile),
-                    m_NetworkInterfaceMTU(networkInterfaceMTU),
-                    m_outputFormat(outputFormat),
-                    m_terminateWaitObj(Pylon::WaitObjectEx::Create())
+                    m_controlPin(controlPin),
+                    m_settings(settings),
+                    m_terminateWaitObj(Pylon::WaitObjectEx::Create()),
+                    m_actionCommandRate(settings.frameRate)
     {
-        m_waitObjectsContainer.Add(m_terminateWaitObj);
+        if(m_settings.cameraIDs.empty() || m_settings.cameraIDs.size() > MAX_NUMBER_OF_CAMERAS)
+        {
+            throw std::invalid_argument("CameraID must list between 1 and " + std::to_string(MAX_NUMBER_OF_CAMERAS) + " serial numbers.");
+        }
     }
 
     int run();
 
+private:
+    void issueActionCommands();
+    void publishTelemetry(std::vector<std::unique_ptr<CameraTelemetry>>& telemetry);
+    void receiveControl(std::vector<std::unique_ptr<ControlMailbox>>& mailboxes);
+
+    // Frames per second the action commands are issued at, FrameRate can change it while grabbing.
+    std::atomic<uint64_t> m_actionCommandRate;
 };
 
 
+Pylon::EGrabStrategy grabStrategyFromString(const std::string& grabStrategy);
+
+// How a control parameter takes effect on a camera that is grabbing.
+enum class ControlEffect
+{
+    Live,       // Between two frames.
+    FrameSize   // Grabbing is stopped and started again with frames of the new size.
+};
+
+/*
+    Sets the field of settings that a control parameter is named after. Throws
+    std::invalid_argument if the value is not valid or the parameter cannot be changed while
+    the camera is grabbing.
+*/
+ControlEffect applyControlParameter(BaslerCamSettings& settings, const ControlParameter& parameter);
+
+
 class BaslerCamConfigEvents : public Pylon::CConfigurationEventHandler
 {
 public:
     uint64_t m_frameWidth, m_frameHeight, m_frameRate;
     bool m_autoGain = false;
+    RoiSettings m_roi;
+    // Where OnOpened reports what the sensor does, the rest is left to the host.
+    SensorReduction* m_sensorReduction;
     void OnOpened(Pylon::CInstantCamera& camera);
     BaslerCamConfigEvents(uint64_t frameWidth, 
                           uint64_t frameHeight,
                           uint64_t frameRate,
-                          bool autoGain) :
+                          bool autoGain,
+                          const RoiSettings& roi,
+                          SensorReduction* sensorReduction) :
                           m_frameWidth(frameWidth),
                           m_frameHeight(frameHeight),
                           m_frameRate(frameRate),
-                          m_autoGain(autoGain)
+                          m_autoGain(autoGain),
+                          m_roi(roi),
+                          m_sensorReduction(sensorReduction)
     {
     }
 };
@@ -0,0 +1,339 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+/*
+    Runs synthetic frames through the same convert and publish path the node uses, for every
+    output format at a few sensor resolutions, and reports throughput, per stage latency and CPU
+    time per frame. Publishing serializes the Image like OutputPin::push does, but sends nothing.
+    Needs neither a camera nor a network.
+
+    Before measuring, every vectorized demosaic and unpack kernel the CPU supports is checked
+    against the reference implementation. While measuring, heap allocations are counted over the
+    second half of the frames, when every buffer should be reused. The exit code is 1 if any
+    kernel differs or anything was allocated.
+
+    Usage: ld-node-camera-basler-benchmark [--frames N] [--threads N] [--pipelined]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <flatbuffers/flatbuffers.h>
+
+#include "demosaic.h"
+#include "frameconverter.h"
+#include "framesource.h"
+#include "syntheticframesource.h"
+#include "telemetry.h"
+#include "unpack.h"
+#include "workerpool.h"
+#include "Image_generated.h"
+
+#define BENCHMARK_DEFAULT_FRAMES 200
+
+// Every operator new of the process, from any thread.
+std::atomic<uint64_t> g_allocations(0);
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* memory = std::malloc(size > 0 ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+struct BenchmarkCase
+{
+    const char* name;
+    link_dev::Format format;
+    DemosaicQuality quality;
+    SourcePixelFormat sourceFormat;
+};
+
+struct Resolution
+{
+    uint32_t width;
+    uint32_t height;
+};
+
+bool checkDemosaicKernels()
+{
+    const InstructionSet instructionSets[] = { InstructionSet::Scalar, InstructionSet::SSE41, InstructionSet::AVX2, InstructionSet::NEON };
+    const DemosaicQuality qualities[] = { DemosaicQuality::Binned, DemosaicQuality::Bilinear, DemosaicQuality::EdgeAware };
+    const BayerPattern patterns[] = { BayerPattern::BG, BayerPattern::GB, BayerPattern::GR, BayerPattern::RG };
+    // Odd sizes so that the scalar tails of the vector loops are exercised as well.
+    const uint32_t width = 333, height = 67;
+
+    Pylon::WaitObjectEx terminate = Pylon::WaitObjectEx::Create();
+    bool allExact = true;
+
+    for(BayerPattern pattern : patterns)
+    {
+        SyntheticSourceSettings sourceSettings;
+        sourceSettings.width = width;
+        sourceSettings.height = height;
+        sourceSettings.frameRate = 0.0;
+        sourceSettings.bayerPattern = pattern;
+        SyntheticFrameSource source(sourceSettings, terminate);
+        source.start(SourcePixelFormat::Bayer8);
+
+        RawFrame frame;
+        GrabError error;
+        source.grab(frame, error);
+
+        for(DemosaicQuality quality : qualities)
+        {
+            std::vector<uint8_t> expected((size_t) width * height * 3);
+            demosaicReference(frame.buffer, width, width, height, pattern, quality, ColorOrder::RGB, expected.data(), (size_t) width * 3);
+
+            for(InstructionSet instructionSet : instructionSets)
+            {
+                Demosaicer demosaicer(quality, ColorOrder::RGB, instructionSet);
+                if(demosaicer.instructionSet() != instructionSet)
+                {
+                    continue;   // Not supported by this CPU.
+                }
+
+                std::vector<uint8_t> actual((size_t) width * height * 3);
+                demosaicer.process(frame.buffer, width, width, height, pattern, actual.data(), (size_t) width * 3);
+                if(actual != expected)
+                {
+                    std::cerr << "Demosaic mismatch: " << instructionSetName(instructionSet)
+                              << " kernels, quality " << (int) quality << ", pattern " << (int) pattern << std::endl;
+                    allExact = false;
+                }
+            }
+        }
+    }
+    return allExact;
+}
+
+bool checkUnpackKernels()
+{
+    const InstructionSet instructionSets[] = { InstructionSet::Scalar, InstructionSet::SSE41, InstructionSet::AVX2, InstructionSet::NEON };
+    const uint32_t bitDepths[] = { 10, 12 };
+    // Odd, so that the last pair is cut in half and the vector loops have tails.
+    const size_t numberOfPixels = 1001;
+
+    std::vector<uint8_t> packed(Unpacker::packedSize(numberOfPixels));
+    uint32_t noise = 0x9E3779B9;
+    for(uint8_t& byte : packed)
+    {
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        byte = (uint8_t) noise;
+    }
+
+    bool allExact = true;
+    for(uint32_t bitDepth : bitDepths)
+    {
+        std::vector<uint16_t> expected(numberOfPixels);
+        unpackReference(packed.data(), numberOfPixels, bitDepth, expected.data());
+
+        for(InstructionSet instructionSet : instructionSets)
+        {
+            Unpacker unpacker(bitDepth, instructionSet);
+            if(unpacker.instructionSet() != instructionSet)
+            {
+                continue;   // Not supported by this CPU.
+            }
+
+            // In two bands, the way the conversion threads split a frame.
+            std::vector<uint16_t> actual(numberOfPixels);
+            unpacker.process(packed.data(), actual.data(), 0, 498);
+            unpacker.process(packed.data(), actual.data(), 498, numberOfPixels);
+            if(actual != expected)
+            {
+                std::cerr << "Unpack mismatch: " << instructionSetName(instructionSet)
+                          << " kernels, " << bitDepth << " bit" << std::endl;
+                allExact = false;
+            }
+        }
+    }
+    return allExact;
+}
+
+// Returns the number of heap allocations during the second half of the frames.
+uint64_t runCase(const BenchmarkCase& benchmarkCase, const Resolution& resolution,
+                 uint64_t frames, size_t conversionThreads, bool pipelined)
+{
+    bool bayer = isBayer(benchmarkCase.sourceFormat);
+
+    SyntheticSourceSettings sourceSettings;
+    sourceSettings.width = resolution.width;
+    sourceSettings.height = resolution.height;
+    sourceSettings.frameRate = 0.0;
+    sourceSettings.frameLimit = frames;
+
+    Pylon::WaitObjectEx terminate = Pylon::WaitObjectEx::Create();
+    SyntheticFrameSource source(sourceSettings, terminate);
+    source.start(benchmarkCase.sourceFormat);
+    BayerPattern bayerPattern = source.bayerPattern();
+
+    std::unique_ptr<Unpacker> unpacker;
+    if(isPacked(benchmarkCase.sourceFormat))
+    {
+        unpacker.reset(new Unpacker(source.bitDepth()));
+    }
+
+    Demosaicer demosaicer(benchmarkCase.quality, ColorOrder::RGB);
+    WorkerPool conversionPool(conversionThreads);
+    FrameReducer reducer(SoftwareReduction(), bayer);
+    CameraTelemetry telemetry("synthetic");
+    flatbuffers::FlatBufferBuilder builder;
+
+    // Enough buffers for both queues, like the node sizes its pool.
+    PipelineSettings pipelineSettings;
+    size_t numberOfImageBuffers = pipelined ? pipelineSettings.publishQueueDepth + 2 : 1;
+    FrameBufferPool bufferPool(numberOfImageBuffers + FRAME_BUFFER_POOL_SPARE,
+                               convertedImageSize(resolution.width, resolution.height, benchmarkCase.format,
+                                                  demosaicer, reducer, unpacker.get()));
+
+    uint64_t publishedFrames = 0;
+    uint64_t allocationsAtHalf = 0;
+    uint64_t allocationsAtEnd = 0;
+
+    auto convert = [&](RawFrame& rawFrame, ConvertedFrame& convertedFrame)
+    {
+        convertedFrame.info.convertStart = steadyClockNs();
+        bool converted = convertFrame(rawFrame, convertedFrame, benchmarkCase.format, demosaicer, bayerPattern, reducer,
+                                      unpacker.get(), bufferPool, conversionPool);
+        convertedFrame.info.convertEnd = steadyClockNs();
+        return converted;
+    };
+    auto publish = [&](ConvertedFrame& convertedFrame)
+    {
+        convertedFrame.info.publishStart = steadyClockNs();
+        builder.Clear();
+        builder.Finish(link_dev::Image::Pack(builder, &convertedFrame.image));
+        telemetry.recordPublished(convertedFrame.info, steadyClockNs());
+
+        publishedFrames++;
+        if(publishedFrames == frames / 2)
+        {
+            allocationsAtHalf = g_allocations.load(std::memory_order_relaxed);
+        }
+        else if(publishedFrames == frames)
+        {
+            allocationsAtEnd = g_allocations.load(std::memory_order_relaxed);
+        }
+    };
+
+    // Blocking queues, so that every frame is measured instead of dropped.
+    pipelineSettings.enabled = pipelined;
+    pipelineSettings.convertQueueOverflowPolicy = OverflowPolicy::Block;
+    pipelineSettings.publishQueueOverflowPolicy = OverflowPolicy::Block;
+
+    std::clock_t cpuStart = std::clock();
+    int64_t wallStart = steadyClockNs();
+    runGrabLoop(source, pipelineSettings, convert, publish, telemetry);
+    int64_t wallEnd = steadyClockNs();
+    std::clock_t cpuEnd = std::clock();
+
+    double seconds = (wallEnd - wallStart) / 1e9;
+    std::unique_ptr<link_dev::basler::CameraTelemetryT> result = telemetry.collect(seconds);
+    double cpuMsPerFrame = result->frames > 0 ? 1000.0 * (cpuEnd - cpuStart) / CLOCKS_PER_SEC / result->frames : 0.0;
+    uint64_t steadyAllocations = allocationsAtEnd >= allocationsAtHalf ? allocationsAtEnd - allocationsAtHalf : 0;
+    uint64_t steadyFrames = frames - frames / 2;
+
+    std::printf("%-18s %5ux%-5u %8.1f %9.2f", benchmarkCase.name, resolution.width, resolution.height, result->fps, cpuMsPerFrame);
+    for(const std::unique_ptr<link_dev::basler::StageLatencyT>& latency : result->latencies)
+    {
+        if(latency->stage.compare("Convert") == 0 || latency->stage.compare("Publish") == 0 || latency->stage.compare("Total") == 0)
+        {
+            std::printf(" %8.0f %8.0f", latency->p50_us, latency->p99_us);
+        }
+    }
+    std::printf(" %9.2f\n", steadyFrames > 0 ? (double) steadyAllocations / steadyFrames : 0.0);
+    return steadyAllocations;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t frames = BENCHMARK_DEFAULT_FRAMES;
+    size_t conversionThreads = 1;
+    bool pipelined = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = std::stoull(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            conversionThreads = std::stoul(argv[++i]);
+        }
+        else if(std::strcmp(argv[i], "--pipelined") == 0)
+        {
+            pipelined = true;
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--frames N] [--threads N] [--pipelined]" << std::endl;
+            return 2;
+        }
+    }
+
+    bool demosaicExact = checkDemosaicKernels();
+    bool unpackExact = checkUnpackKernels();
+    bool kernelsExact = demosaicExact && unpackExact;
+    std::cout << "Demosaic kernels match the reference: " << (demosaicExact ? "yes" : "NO") << std::endl;
+    std::cout << "Unpack kernels match the reference: " << (unpackExact ? "yes" : "NO") << std::endl;
+    std::cout << "Best instruction set: " << instructionSetName(bestInstructionSet())
+              << ", conversion threads: " << conversionThreads
+              << (pipelined ? ", pipelined" : ", inline") << std::endl << std::endl;
+
+    const BenchmarkCase cases[] = {
+        { "GRAY_U8", link_dev::Format_GRAY_U8, DemosaicQuality::Bilinear, SourcePixelFormat::Mono8 },
+        { "RGB_U8 Binned", link_dev::Format_RGB_U8, DemosaicQuality::Binned, SourcePixelFormat::Bayer8 },
+        { "RGB_U8 Bilinear", link_dev::Format_RGB_U8, DemosaicQuality::Bilinear, SourcePixelFormat::Bayer8 },
+        { "RGB_U8 EdgeAware", link_dev::Format_RGB_U8, DemosaicQuality::EdgeAware, SourcePixelFormat::Bayer8 },
+        // Raw output: passed through, or unpacked from 12 bit.
+        { "BAYER_U8", link_dev::Format_GRAY_U8, DemosaicQuality::Bilinear, SourcePixelFormat::Bayer8 },
+        { "BAYER_U16", link_dev::Format_GRAY_U8, DemosaicQuality::Bilinear, SourcePixelFormat::BayerPacked },
+    };
+    const Resolution resolutions[] = { {640, 480}, {1280, 1024}, {1920, 1200}, {2448, 2048} };
+
+    std::printf("%-18s %11s %8s %9s %17s %17s %17s %9s\n", "format", "resolution", "fps", "cpu ms/f",
+                "convert p50/p99", "publish p50/p99", "total p50/p99", "allocs/f");
+
+    uint64_t steadyAllocations = 0;
+    for(const BenchmarkCase& benchmarkCase : cases)
+    {
+        for(const Resolution& resolution : resolutions)
+        {
+            steadyAllocations += runCase(benchmarkCase, resolution, frames, conversionThreads, pipelined);
+        }
+    }
+    std::cout << std::endl << "Allocations once warmed up: " << steadyAllocations << std::endl;
+
+    return kernelsExact && steadyAllocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "cameraclock.h"
+
+void CameraClock::reset(double nominalNsPerTick)
+{
+    m_nominalNsPerTick = nominalNsPerTick;
+    m_samples.clear();
+    m_fitted = false;
+}
+
+void CameraClock::addSample(uint64_t cameraTicks, int64_t hostBefore, int64_t hostAfter)
+{
+    Sample sample;
+    sample.cameraTicks = cameraTicks;
+    sample.hostTime = hostBefore + (hostAfter - hostBefore) / 2;
+    sample.roundTrip = hostAfter - hostBefore;
+
+    if(!m_samples.empty())
+    {
+        bool backwards = cameraTicks <= m_samples.back().cameraTicks;
+        if(backwards || std::llabs(toHost(cameraTicks) - sample.hostTime) > sample.roundTrip + CAMERA_CLOCK_MAX_STEP_NS)
+        {
+            m_samples.clear();
+        }
+    }
+
+    m_samples.push_back(sample);
+    if(m_samples.size() > CAMERA_CLOCK_SAMPLES)
+    {
+        m_samples.pop_front();
+    }
+    fit();
+}
+
+int64_t CameraClock::toHost(uint64_t cameraTicks) const
+{
+    if(!m_fitted)
+    {
+        return 0;
+    }
+    // Differences in ticks fit into a double without loss, absolute timestamps do not.
+    double ticks = (double) (int64_t) (cameraTicks - m_referenceTicks);
+    return m_referenceHost + (int64_t) std::llround(m_offsetNs + m_nsPerTick * ticks);
+}
+
+// Least squares through the readings that were quick enough, relative to the newest one.
+void CameraClock::fit()
+{
+    const Sample& newest = m_samples.back();
+    m_referenceTicks = newest.cameraTicks;
+    m_referenceHost = newest.hostTime;
+
+    int64_t quickest = newest.roundTrip;
+    for(const Sample& sample : m_samples)
+    {
+        quickest = std::min(quickest, sample.roundTrip);
+    }
+
+    size_t count = 0;
+    double sumTicks = 0, sumHost = 0;
+    for(const Sample& sample : m_samples)
+    {
+        if(sample.roundTrip <= 2 * quickest)
+        {
+            sumTicks += (double) (int64_t) (sample.cameraTicks - m_referenceTicks);
+            sumHost += (double) (sample.hostTime - m_referenceHost);
+            count++;
+        }
+    }
+    double meanTicks = sumTicks / count;
+    double meanHost = sumHost / count;
+
+    double sumSquares = 0, sumProducts = 0;
+    for(const Sample& sample : m_samples)
+    {
+        if(sample.roundTrip <= 2 * quickest)
+        {
+            double ticks = (double) (int64_t) (sample.cameraTicks - m_referenceTicks) - meanTicks;
+            double host = (double) (sample.hostTime - m_referenceHost) - meanHost;
+            sumSquares += ticks * ticks;
+            sumProducts += ticks * host;
+        }
+    }
+
+    m_nsPerTick = count >= 2 && sumSquares > 0 ? sumProducts / sumSquares : m_nominalNsPerTick;
+    m_offsetNs = meanHost - m_nsPerTick * meanTicks;
+    m_fitted = true;
+}
@@ -0,0 +1,69 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef CAMERACLOCK_HPP
+#define CAMERACLOCK_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+// Readings of the camera clock the fit goes through, at ClockSyncIntervalMs apart.
+#define CAMERA_CLOCK_SAMPLES 16
+// A reading further than this plus its round trip from the fit means one of the clocks jumped.
+#define CAMERA_CLOCK_MAX_STEP_NS 1000000
+
+inline int64_t systemClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/*
+    Maps camera timestamps to the host's system clock with a straight line fitted through the
+    last readings of the camera clock. Every reading is taken between two readings of the host
+    clock. Readings that took more than twice as long as the quickest one, because the host or
+    the link was busy, are left out of the fit, so that a loaded host does not drag the
+    timestamps. When either clock jumps, the fit starts over.
+
+    Not thread safe, PylonFrameSource guards it with a mutex shared by its grab and clock threads.
+*/
+class CameraClock
+{
+public:
+    // Forgets all readings, for a camera whose clock started over.
+    void reset(double nominalNsPerTick);
+
+    // cameraTicks were latched after hostBefore and before hostAfter, in nanoseconds of the system clock.
+    void addSample(uint64_t cameraTicks, int64_t hostBefore, int64_t hostAfter);
+
+    // Nanoseconds since the Unix epoch, 0 before the first reading.
+    int64_t toHost(uint64_t cameraTicks) const;
+
+private:
+    struct Sample
+    {
+        uint64_t cameraTicks;
+        int64_t hostTime;
+        int64_t roundTrip;
+    };
+
+    void fit();
+
+    // Until there are two readings to fit a rate through.
+    double m_nominalNsPerTick = 1.0;
+    std::deque<Sample> m_samples;
+
+    // host = m_referenceHost + m_offsetNs + m_nsPerTick * (ticks - m_referenceTicks)
+    uint64_t m_referenceTicks = 0;
+    int64_t m_referenceHost = 0;
+    double m_offsetNs = 0;
+    double m_nsPerTick = 1.0;
+    bool m_fitted = false;
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "cameracontrol.h"
+
+void ControlMailbox::post(const std::vector<ControlParameter>& parameters)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(const ControlParameter& parameter : parameters)
+    {
+        bool merged = false;
+        for(ControlParameter& waiting : m_parameters)
+        {
+            if(waiting.name.compare(parameter.name) == 0)
+            {
+                waiting.value = parameter.value;
+                merged = true;
+                break;
+            }
+        }
+        if(!merged)
+        {
+            m_parameters.push_back(parameter);
+        }
+    }
+    m_pending.store(!m_parameters.empty(), std::memory_order_release);
+    if(!m_parameters.empty())
+    {
+        m_postedWaitObj.Signal();
+    }
+}
+
+bool ControlMailbox::take(std::vector<ControlParameter>& parameters)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    parameters.clear();
+    parameters.swap(m_parameters);
+    m_pending.store(false, std::memory_order_release);
+    m_postedWaitObj.Reset();
+    return !parameters.empty();
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef CAMERACONTROL_HPP
+#define CAMERACONTROL_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pylon/PylonIncludes.h>
+
+// One setting of a CameraControl message, named like the key in the node configuration.
+struct ControlParameter
+{
+    std::string name;
+    std::string value;
+};
+
+/*
+    Hands control parameters from the control input pin to the grab thread of one camera,
+    which picks them up between two frames. Parameters posted before the grab thread got to
+    them are merged, the newest value of a parameter wins and keeps its first position.
+
+    A source that blocks until the next frame, e.g. a camera waiting for its trigger, also waits
+    on postedWaitObject() so that parameters are applied before that frame is exposed.
+*/
+class ControlMailbox
+{
+public:
+    ControlMailbox() : m_pending(false), m_postedWaitObj(Pylon::WaitObjectEx::Create()) {}
+
+    void post(const std::vector<ControlParameter>& parameters);
+    // Moves everything posted so far into parameters. Returns false if there was nothing.
+    bool take(std::vector<ControlParameter>& parameters);
+
+    // Cheap enough to ask after every frame.
+    bool pending() const { return m_pending.load(std::memory_order_acquire); }
+
+    // Signaled by post(), reset by take().
+    Pylon::WaitObjectEx postedWaitObject() const { return m_postedWaitObj; }
+
+private:
+    std::mutex m_mutex;
+    std::vector<ControlParameter> m_parameters;
+    std::atomic<bool> m_pending;
+    Pylon::WaitObjectEx m_postedWaitObj;
+};
+
+#endif
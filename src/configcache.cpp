@@ -0,0 +1,139 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "configcache.h"
+
+ConfigCacheMode configCacheModeFromString(const std::string& mode)
+{
+    if(mode.compare("Off") == 0)
+    {
+        return ConfigCacheMode::Off;
+    }
+    else if(mode.compare("FeatureFile") == 0)
+    {
+        return ConfigCacheMode::FeatureFile;
+    }
+    else if(mode.compare("UserSet") == 0)
+    {
+        return ConfigCacheMode::UserSet;
+    }
+    throw std::invalid_argument("Unknown configuration cache mode: " + mode);
+}
+
+CameraConfigCache::CameraConfigCache(const ConfigCacheSettings& settings, const std::string& serialNumber, const std::string& key) :
+                                     m_settings(settings),
+                                     m_serialNumber(serialNumber),
+                                     m_key(key)
+{
+    if(m_settings.mode == ConfigCacheMode::Off)
+    {
+        return;
+    }
+
+    std::ifstream entry(pathFor(".cache"));
+    std::string entryKey;
+    if(!std::getline(entry, entryKey) || entryKey.compare(m_key) != 0)
+    {
+        return;
+    }
+    entry >> m_pixelFormat >> m_width >> m_height
+          >> m_sensorReduction.offsetApplied
+          >> m_sensorReduction.binningX >> m_sensorReduction.binningY
+          >> m_sensorReduction.decimationX >> m_sensorReduction.decimationY;
+    if(!entry)
+    {
+        return;
+    }
+
+    m_available = m_settings.mode == ConfigCacheMode::UserSet || std::ifstream(pathFor(".pfs")).good();
+}
+
+std::string CameraConfigCache::pathFor(const std::string& extension) const
+{
+    if(m_settings.directory.empty())
+    {
+        return m_serialNumber + extension;
+    }
+    return m_settings.directory + "/" + m_serialNumber + extension;
+}
+
+bool CameraConfigCache::restore(GenApi::INodeMap& nodemap, std::string& pixelFormat, SensorReduction& sensorReduction)
+{
+    try
+    {
+        if(m_settings.mode == ConfigCacheMode::FeatureFile)
+        {
+            Pylon::CFeaturePersistence::Load(pathFor(".pfs").c_str(), &nodemap, true);
+        }
+        else
+        {
+            Pylon::CEnumParameter(nodemap, "UserSetSelector").SetValue(CONFIG_CACHE_USER_SET);
+            Pylon::CCommandParameter(nodemap, "UserSetLoad").Execute();
+        }
+
+        // The file or the user set may have been changed by someone else since.
+        if(std::string(Pylon::CEnumParameter(nodemap, "PixelFormat").GetValue().c_str()).compare(m_pixelFormat) != 0 ||
+           Pylon::CIntegerParameter(nodemap, "Width").GetValue() != m_width ||
+           Pylon::CIntegerParameter(nodemap, "Height").GetValue() != m_height)
+        {
+            std::cout << "The cached configuration of camera " << m_serialNumber << " is out of date." << std::endl;
+            return false;
+        }
+    }
+    catch(const Pylon::GenericException& e)
+    {
+        std::cerr << "Could not restore the cached configuration of camera " << m_serialNumber << ": " << e.GetDescription() << std::endl;
+        return false;
+    }
+
+    pixelFormat = m_pixelFormat;
+    sensorReduction = m_sensorReduction;
+    return true;
+}
+
+void CameraConfigCache::store(GenApi::INodeMap& nodemap, const std::string& pixelFormat, const SensorReduction& sensorReduction)
+{
+    // The old entry goes first, so that an interrupted store leaves no entry rather than a wrong one.
+    std::remove(pathFor(".cache").c_str());
+
+    try
+    {
+        if(m_settings.mode == ConfigCacheMode::FeatureFile)
+        {
+            Pylon::CFeaturePersistence::Save(pathFor(".pfs").c_str(), &nodemap);
+        }
+        else
+        {
+            Pylon::CEnumParameter(nodemap, "UserSetSelector").SetValue(CONFIG_CACHE_USER_SET);
+            Pylon::CCommandParameter(nodemap, "UserSetSave").Execute();
+        }
+
+        std::ofstream entry(pathFor(".cache"), std::ios::trunc);
+        entry << m_key << "\n"
+              << pixelFormat << "\n"
+              << Pylon::CIntegerParameter(nodemap, "Width").GetValue() << " "
+              << Pylon::CIntegerParameter(nodemap, "Height").GetValue() << "\n"
+              << sensorReduction.offsetApplied << " "
+              << sensorReduction.binningX << " " << sensorReduction.binningY << " "
+              << sensorReduction.decimationX << " " << sensorReduction.decimationY << std::endl;
+        if(!entry)
+        {
+            std::cerr << "Could not write " << pathFor(".cache") << std::endl;
+            entry.close();
+            std::remove(pathFor(".cache").c_str());
+        }
+    }
+    catch(const Pylon::GenericException& e)
+    {
+        std::cerr << "Could not cache the configuration of camera " << m_serialNumber << ": " << e.GetDescription() << std::endl;
+    }
+}
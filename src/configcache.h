@@ -0,0 +1,77 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef CONFIGCACHE_HPP
+#define CONFIGCACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include <pylon/PylonIncludes.h>
+
+#include "framereducer.h"
+
+// Bump whenever the node configures the camera differently, so that old entries are not used.
+#define CONFIG_CACHE_VERSION 1
+#define CONFIG_CACHE_USER_SET "UserSet1"
+
+enum class ConfigCacheMode
+{
+    Off,
+    FeatureFile,    // A Pylon feature file on the host.
+    UserSet         // A user set in the camera, restored by a single command.
+};
+
+ConfigCacheMode configCacheModeFromString(const std::string& mode);
+
+struct ConfigCacheSettings
+{
+    ConfigCacheMode mode = ConfigCacheMode::Off;
+    // Where the cache files are kept. Empty is the working directory.
+    std::string directory;
+};
+
+/*
+    Remembers the configuration the node applied to a camera, so that the next start with the
+    same settings restores it in one step instead of writing every parameter again. The key
+    describes everything that went into the configuration, including camera model and firmware.
+    It is kept in <serial number>.cache together with what the host needs to know about the
+    result; the configuration itself goes to <serial number>.pfs or into the camera's user set.
+*/
+class CameraConfigCache
+{
+public:
+    CameraConfigCache(const ConfigCacheSettings& settings, const std::string& serialNumber, const std::string& key);
+
+    // Whether there is an entry for the key. Does not touch the camera.
+    bool available() const { return m_available; }
+
+    /*
+        Restores the configuration and checks that the camera ended up with the cached pixel
+        format and image size. Returns false if it did not, then the camera has to be
+        configured from scratch.
+    */
+    bool restore(GenApi::INodeMap& nodemap, std::string& pixelFormat, SensorReduction& sensorReduction);
+
+    // Saves the configuration the camera has now under the key. Failures are only reported.
+    void store(GenApi::INodeMap& nodemap, const std::string& pixelFormat, const SensorReduction& sensorReduction);
+
+private:
+    std::string pathFor(const std::string& extension) const;
+
+    ConfigCacheSettings m_settings;
+    std::string m_serialNumber;
+    std::string m_key;
+    bool m_available = false;
+
+    // What the entry says the configuration results in.
+    std::string m_pixelFormat;
+    int64_t m_width = 0, m_height = 0;
+    SensorReduction m_sensorReduction;
+};
+
+#endif
@@ -0,0 +1,859 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#include "demosaic.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DEMOSAIC_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define DEMOSAIC_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang need the instruction set per function, MSVC allows the intrinsics anywhere.
+#if defined(DEMOSAIC_X86) && defined(__GNUC__)
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE41
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+
+enum Channel
+{
+    Red = 0,
+    Green = 1,
+    Blue = 2
+};
+
+// Color of the top left 2x2 cell, indexed by [pattern][y & 1][x & 1].
+const int bayerLayout[4][2][2] =
+{
+    { { Blue, Green }, { Green, Red } },   // BG
+    { { Green, Blue }, { Red, Green } },   // GB
+    { { Green, Red }, { Blue, Green } },   // GR
+    { { Red, Green }, { Green, Blue } }    // RG
+};
+
+inline int colorAt(BayerPattern pattern, int64_t x, int64_t y)
+{
+    return bayerLayout[(int) pattern][y & 1][x & 1];
+}
+
+// Mirrors without repeating the border sample, so a mirrored neighbor has the same color.
+inline int64_t reflect101(int64_t i, int64_t n)
+{
+    if(i < 0)
+    {
+        return -i;
+    }
+    if(i >= n)
+    {
+        return 2 * n - 2 - i;
+    }
+    return i;
+}
+
+inline void channelOffsets(ColorOrder colorOrder, int offsets[3])
+{
+    offsets[Red] = colorOrder == ColorOrder::RGB ? 0 : 2;
+    offsets[Green] = 1;
+    offsets[Blue] = colorOrder == ColorOrder::RGB ? 2 : 0;
+}
+
+/*
+    Everything the bilinear and edge aware tiers need for one output pixel is one of these five
+    values, computed from the 3x3 neighborhood. Which one goes into which channel only depends
+    on the filter pattern, the row and the parity of the column.
+*/
+enum Quantity
+{
+    Center,
+    Cross,  // Average of the four direct neighbors (green at red/blue sites).
+    Diag,   // Average of the four diagonal neighbors.
+    Horz,   // Average of left and right neighbor.
+    Vert    // Average of upper and lower neighbor.
+};
+
+struct RowPlan
+{
+    int quantity[2][3];  // [x & 1][channel]
+};
+
+RowPlan planRow(BayerPattern pattern, int64_t y)
+{
+    RowPlan plan;
+    for(int parity = 0; parity < 2; parity++)
+    {
+        int site = colorAt(pattern, parity, y);
+        if(site != Green)
+        {
+            plan.quantity[parity][site] = Center;
+            plan.quantity[parity][Green] = Cross;
+            plan.quantity[parity][Blue - site] = Diag;
+        }
+        else
+        {
+            plan.quantity[parity][Green] = Center;
+            plan.quantity[parity][colorAt(pattern, parity + 1, y)] = Horz;
+            plan.quantity[parity][colorAt(pattern, parity, y + 1)] = Vert;
+        }
+    }
+    return plan;
+}
+
+inline uint8_t average2(int a, int b)
+{
+    return (uint8_t) ((a + b + 1) >> 1);
+}
+
+inline uint8_t average4(int a, int b, int c, int d)
+{
+    return (uint8_t) ((a + b + c + d + 2) >> 2);
+}
+
+// Green at a red/blue site, interpolated along the direction with the smaller gradient.
+inline uint8_t edgeAwareGreen(int left, int right, int up, int down)
+{
+    int gradientH = std::abs(left - right);
+    int gradientV = std::abs(up - down);
+    if(gradientH < gradientV)
+    {
+        return average2(left, right);
+    }
+    if(gradientV < gradientH)
+    {
+        return average2(up, down);
+    }
+    return average4(left, right, up, down);
+}
+
+template <bool EdgeAware>
+inline void interpolatePixel(const uint8_t* up, const uint8_t* row, const uint8_t* down,
+                             int64_t x, int64_t width, const RowPlan& plan,
+                             const int offsets[3], uint8_t* destination)
+{
+    int64_t left = reflect101(x - 1, width);
+    int64_t right = reflect101(x + 1, width);
+
+    uint8_t values[5];
+    values[Center] = row[x];
+    values[Cross] = EdgeAware ? edgeAwareGreen(row[left], row[right], up[x], down[x])
+                              : average4(row[left], row[right], up[x], down[x]);
+    values[Diag] = average4(up[left], up[right], down[left], down[right]);
+    values[Horz] = average2(row[left], row[right]);
+    values[Vert] = average2(up[x], down[x]);
+
+    const int* quantity = plan.quantity[x & 1];
+    uint8_t* pixel = destination + 3 * x;
+    pixel[offsets[Red]] = values[quantity[Red]];
+    pixel[offsets[Green]] = values[quantity[Green]];
+    pixel[offsets[Blue]] = values[quantity[Blue]];
+}
+
+/*
+    Vectorized kernels. Each one handles the interior of a row starting at the even column 2,
+    in whole vectors, and returns the first column it did not touch. The caller finishes the
+    borders and the tail with interpolatePixel.
+*/
+#if defined(DEMOSAIC_X86)
+
+// pshufb masks that interleave three planes of 16 bytes into 48 bytes, [output block][plane].
+alignas(16) const uint8_t interleaveMasks[9][16] =
+{
+    { 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80, 5 },
+    { 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80 },
+    { 0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80 },
+    { 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10, 0x80 },
+    { 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10 },
+    { 0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80 },
+    { 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80, 0x80 },
+    { 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80 },
+    { 10, 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15 }
+};
+
+TARGET_SSE41 inline void storeInterleaved(uint8_t* destination, __m128i first, __m128i second, __m128i third)
+{
+    const __m128i* masks = (const __m128i*) interleaveMasks;
+    for(int block = 0; block < 3; block++)
+    {
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(first, _mm_load_si128(masks + 3 * block)),
+                                                _mm_shuffle_epi8(second, _mm_load_si128(masks + 3 * block + 1))),
+                                   _mm_shuffle_epi8(third, _mm_load_si128(masks + 3 * block + 2)));
+        _mm_storeu_si128((__m128i*) (destination + 16 * block), out);
+    }
+}
+
+TARGET_SSE41 inline __m128i average4SSE(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    __m128i low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                                _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+    __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+                                 _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+    low = _mm_srli_epi16(_mm_add_epi16(low, two), 2);
+    high = _mm_srli_epi16(_mm_add_epi16(high, two), 2);
+    return _mm_packus_epi16(low, high);
+}
+
+// Unsigned a < b for every byte.
+TARGET_SSE41 inline __m128i lessThanSSE(__m128i a, __m128i b)
+{
+    return _mm_andnot_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(_mm_min_epu8(a, b), a));
+}
+
+template <bool EdgeAware>
+TARGET_SSE41 int64_t interpolateRowSSE41(const uint8_t* up, const uint8_t* row, const uint8_t* down,
+                                         int64_t width, const RowPlan& plan, ColorOrder colorOrder,
+                                         uint8_t* destination)
+{
+    const __m128i oddLanes = _mm_set1_epi16((short) 0xFF00);
+    int64_t x = 2;
+
+    for(; x + 16 <= width - 1; x += 16)
+    {
+        __m128i left = _mm_loadu_si128((const __m128i*) (row + x - 1));
+        __m128i center = _mm_loadu_si128((const __m128i*) (row + x));
+        __m128i right = _mm_loadu_si128((const __m128i*) (row + x + 1));
+        __m128i above = _mm_loadu_si128((const __m128i*) (up + x));
+        __m128i below = _mm_loadu_si128((const __m128i*) (down + x));
+        __m128i aboveLeft = _mm_loadu_si128((const __m128i*) (up + x - 1));
+        __m128i aboveRight = _mm_loadu_si128((const __m128i*) (up + x + 1));
+        __m128i belowLeft = _mm_loadu_si128((const __m128i*) (down + x - 1));
+        __m128i belowRight = _mm_loadu_si128((const __m128i*) (down + x + 1));
+
+        __m128i values[5];
+        values[Center] = center;
+        values[Diag] = average4SSE(aboveLeft, aboveRight, belowLeft, belowRight);
+        values[Horz] = _mm_avg_epu8(left, right);
+        values[Vert] = _mm_avg_epu8(above, below);
+        values[Cross] = average4SSE(left, right, above, below);
+        if(EdgeAware)
+        {
+            __m128i gradientH = _mm_or_si128(_mm_subs_epu8(left, right), _mm_subs_epu8(right, left));
+            __m128i gradientV = _mm_or_si128(_mm_subs_epu8(above, below), _mm_subs_epu8(below, above));
+            values[Cross] = _mm_blendv_epi8(values[Cross], values[Vert], lessThanSSE(gradientV, gradientH));
+            values[Cross] = _mm_blendv_epi8(values[Cross], values[Horz], lessThanSSE(gradientH, gradientV));
+        }
+
+        __m128i channels[3];
+        for(int channel = 0; channel < 3; channel++)
+        {
+            channels[channel] = _mm_blendv_epi8(values[plan.quantity[0][channel]],
+                                                values[plan.quantity[1][channel]], oddLanes);
+        }
+
+        if(colorOrder == ColorOrder::RGB)
+        {
+            storeInterleaved(destination + 3 * x, channels[Red], channels[Green], channels[Blue]);
+        }
+        else
+        {
+            storeInterleaved(destination + 3 * x, channels[Blue], channels[Green], channels[Red]);
+        }
+    }
+    return x;
+}
+
+TARGET_AVX2 inline __m256i average4AVX2(__m256i a, __m256i b, __m256i c, __m256i d)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i two = _mm256_set1_epi16(2);
+    __m256i low = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)),
+                                   _mm256_add_epi16(_mm256_unpacklo_epi8(c, zero), _mm256_unpacklo_epi8(d, zero)));
+    __m256i high = _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)),
+                                    _mm256_add_epi16(_mm256_unpackhi_epi8(c, zero), _mm256_unpackhi_epi8(d, zero)));
+    low = _mm256_srli_epi16(_mm256_add_epi16(low, two), 2);
+    high = _mm256_srli_epi16(_mm256_add_epi16(high, two), 2);
+    // Unpack and pack both work per 128 bit lane, so the byte order comes out unchanged.
+    return _mm256_packus_epi16(low, high);
+}
+
+TARGET_AVX2 inline __m256i lessThanAVX2(__m256i a, __m256i b)
+{
+    return _mm256_andnot_si256(_mm256_cmpeq_epi8(a, b), _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a));
+}
+
+TARGET_AVX2 inline void storeInterleavedAVX2(uint8_t* destination, __m256i first, __m256i second, __m256i third)
+{
+    storeInterleaved(destination, _mm256_castsi256_si128(first), _mm256_castsi256_si128(second),
+                     _mm256_castsi256_si128(third));
+    storeInterleaved(destination + 48, _mm256_extracti128_si256(first, 1), _mm256_extracti128_si256(second, 1),
+                     _mm256_extracti128_si256(third, 1));
+}
+
+template <bool EdgeAware>
+TARGET_AVX2 int64_t interpolateRowAVX2(const uint8_t* up, const uint8_t* row, const uint8_t* down,
+                                       int64_t width, const RowPlan& plan, ColorOrder colorOrder,
+                                       uint8_t* destination)
+{
+    const __m256i oddLanes = _mm256_set1_epi16((short) 0xFF00);
+    int64_t x = 2;
+
+    for(; x + 32 <= width - 1; x += 32)
+    {
+        __m256i left = _mm256_loadu_si256((const __m256i*) (row + x - 1));
+        __m256i center = _mm256_loadu_si256((const __m256i*) (row + x));
+        __m256i right = _mm256_loadu_si256((const __m256i*) (row + x + 1));
+        __m256i above = _mm256_loadu_si256((const __m256i*) (up + x));
+        __m256i below = _mm256_loadu_si256((const __m256i*) (down + x));
+        __m256i aboveLeft = _mm256_loadu_si256((const __m256i*) (up + x - 1));
+        __m256i aboveRight = _mm256_loadu_si256((const __m256i*) (up + x + 1));
+        __m256i belowLeft = _mm256_loadu_si256((const __m256i*) (down + x - 1));
+        __m256i belowRight = _mm256_loadu_si256((const __m256i*) (down + x + 1));
+
+        __m256i values[5];
+        values[Center] = center;
+        values[Diag] = average4AVX2(aboveLeft, aboveRight, belowLeft, belowRight);
+        values[Horz] = _mm256_avg_epu8(left, right);
+        values[Vert] = _mm256_avg_epu8(above, below);
+        values[Cross] = average4AVX2(left, right, above, below);
+        if(EdgeAware)
+        {
+            __m256i gradientH = _mm256_or_si256(_mm256_subs_epu8(left, right), _mm256_subs_epu8(right, left));
+            __m256i gradientV = _mm256_or_si256(_mm256_subs_epu8(above, below), _mm256_subs_epu8(below, above));
+            values[Cross] = _mm256_blendv_epi8(values[Cross], values[Vert], lessThanAVX2(gradientV, gradientH));
+            values[Cross] = _mm256_blendv_epi8(values[Cross], values[Horz], lessThanAVX2(gradientH, gradientV));
+        }
+
+        __m256i channels[3];
+        for(int channel = 0; channel < 3; channel++)
+        {
+            channels[channel] = _mm256_blendv_epi8(values[plan.quantity[0][channel]],
+                                                   values[plan.quantity[1][channel]], oddLanes);
+        }
+
+        if(colorOrder == ColorOrder::RGB)
+        {
+            storeInterleavedAVX2(destination + 3 * x, channels[Red], channels[Green], channels[Blue]);
+        }
+        else
+        {
+            storeInterleavedAVX2(destination + 3 * x, channels[Blue], channels[Green], channels[Red]);
+        }
+    }
+    return x;
+}
+
+// Splits 32 bytes into the 16 even and the 16 odd ones.
+TARGET_SSE41 inline void deinterleaveSSE(const uint8_t* source, __m128i& even, __m128i& odd)
+{
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    __m128i a = _mm_loadu_si128((const __m128i*) source);
+    __m128i b = _mm_loadu_si128((const __m128i*) (source + 16));
+    even = _mm_packus_epi16(_mm_and_si128(a, lowBytes), _mm_and_si128(b, lowBytes));
+    odd = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+TARGET_SSE41 int64_t binRowSSE41(const uint8_t* top, const uint8_t* bottom, int64_t outputWidth,
+                                 const int cellChannel[4], ColorOrder colorOrder, uint8_t* destination)
+{
+    int64_t x = 0;
+    for(; x + 16 <= outputWidth; x += 16)
+    {
+        __m128i cell[4];
+        deinterleaveSSE(top + 2 * x, cell[0], cell[1]);
+        deinterleaveSSE(bottom + 2 * x, cell[2], cell[3]);
+
+        __m128i red = _mm_setzero_si128(), blue = _mm_setzero_si128();
+        __m128i greens[2];
+        int numberOfGreens = 0;
+        for(int i = 0; i < 4; i++)
+        {
+            if(cellChannel[i] == Red) red = cell[i];
+            else if(cellChannel[i] == Blue) blue = cell[i];
+            else greens[numberOfGreens++] = cell[i];
+        }
+        __m128i green = _mm_avg_epu8(greens[0], greens[1]);
+
+        if(colorOrder == ColorOrder::RGB)
+        {
+            storeInterleaved(destination + 3 * x, red, green, blue);
+        }
+        else
+        {
+            storeInterleaved(destination + 3 * x, blue, green, red);
+        }
+    }
+    return x;
+}
+
+TARGET_AVX2 inline void deinterleaveAVX2(const uint8_t* source, __m256i& even, __m256i& odd)
+{
+    const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+    __m256i a = _mm256_loadu_si256((const __m256i*) source);
+    __m256i b = _mm256_loadu_si256((const __m256i*) (source + 32));
+    // packus interleaves the 128 bit lanes of a and b, the permute puts them back in order.
+    even = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(a, lowBytes), _mm256_and_si256(b, lowBytes)), 0xD8);
+    odd = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), 0xD8);
+}
+
+TARGET_AVX2 int64_t binRowAVX2(const uint8_t* top, const uint8_t* bottom, int64_t outputWidth,
+                               const int cellChannel[4], ColorOrder colorOrder, uint8_t* destination)
+{
+    int64_t x = 0;
+    for(; x + 32 <= outputWidth; x += 32)
+    {
+        __m256i cell[4];
+        deinterleaveAVX2(top + 2 * x, cell[0], cell[1]);
+        deinterleaveAVX2(bottom + 2 * x, cell[2], cell[3]);
+
+        __m256i red = _mm256_setzero_si256(), blue = _mm256_setzero_si256();
+        __m256i greens[2];
+        int numberOfGreens = 0;
+        for(int i = 0; i < 4; i++)
+        {
+            if(cellChannel[i] == Red) red = cell[i];
+            else if(cellChannel[i] == Blue) blue = cell[i];
+            else greens[numberOfGreens++] = cell[i];
+        }
+        __m256i green = _mm256_avg_epu8(greens[0], greens[1]);
+
+        if(colorOrder == ColorOrder::RGB)
+        {
+            storeInterleavedAVX2(destination + 3 * x, red, green, blue);
+        }
+        else
+        {
+            storeInterleavedAVX2(destination + 3 * x, blue, green, red);
+        }
+    }
+    return x;
+}
+
+#endif
+
+#if defined(DEMOSAIC_NEON)
+
+inline uint8x16_t average4NEON(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d)
+{
+    uint16x8_t low = vaddq_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(b)), vaddl_u8(vget_low_u8(c), vget_low_u8(d)));
+    uint16x8_t high = vaddq_u16(vaddl_u8(vget_high_u8(a), vget_high_u8(b)), vaddl_u8(vget_high_u8(c), vget_high_u8(d)));
+    // Rounding narrow shift, (sum + 2) >> 2.
+    return vcombine_u8(vrshrn_n_u16(low, 2), vrshrn_n_u16(high, 2));
+}
+
+template <bool EdgeAware>
+int64_t interpolateRowNEON(const uint8_t* up, const uint8_t* row, const uint8_t* down,
+                           int64_t width, const RowPlan& plan, ColorOrder colorOrder,
+                           uint8_t* destination)
+{
+    const uint8x16_t oddLanes = vreinterpretq_u8_u16(vdupq_n_u16(0xFF00));
+    int64_t x = 2;
+
+    for(; x + 16 <= width - 1; x += 16)
+    {
+        uint8x16_t left = vld1q_u8(row + x - 1);
+        uint8x16_t center = vld1q_u8(row + x);
+        uint8x16_t right = vld1q_u8(row + x + 1);
+        uint8x16_t above = vld1q_u8(up + x);
+        uint8x16_t below = vld1q_u8(down + x);
+
+        uint8x16_t values[5];
+        values[Center] = center;
+        values[Diag] = average4NEON(vld1q_u8(up + x - 1), vld1q_u8(up + x + 1),
+                                    vld1q_u8(down + x - 1), vld1q_u8(down + x + 1));
+        values[Horz] = vrhaddq_u8(left, right);
+        values[Vert] = vrhaddq_u8(above, below);
+        values[Cross] = average4NEON(left, right, above, below);
+        if(EdgeAware)
+        {
+            uint8x16_t gradientH = vabdq_u8(left, right);
+            uint8x16_t gradientV = vabdq_u8(above, below);
+            values[Cross] = vbslq_u8(vcltq_u8(gradientV, gradientH), values[Vert], values[Cross]);
+            values[Cross] = vbslq_u8(vcltq_u8(gradientH, gradientV), values[Horz], values[Cross]);
+        }
+
+        uint8x16_t channels[3];
+        for(int channel = 0; channel < 3; channel++)
+        {
+            channels[channel] = vbslq_u8(oddLanes, values[plan.quantity[1][channel]],
+                                         values[plan.quantity[0][channel]]);
+        }
+
+        uint8x16x3_t interleaved;
+        interleaved.val[0] = colorOrder == ColorOrder::RGB ? channels[Red] : channels[Blue];
+        interleaved.val[1] = channels[Green];
+        interleaved.val[2] = colorOrder == ColorOrder::RGB ? channels[Blue] : channels[Red];
+        vst3q_u8(destination + 3 * x, interleaved);
+    }
+    return x;
+}
+
+int64_t binRowNEON(const uint8_t* top, const uint8_t* bottom, int64_t outputWidth,
+                   const int cellChannel[4], ColorOrder colorOrder, uint8_t* destination)
+{
+    int64_t x = 0;
+    for(; x + 16 <= outputWidth; x += 16)
+    {
+        uint8x16x2_t topCells = vld2q_u8(top + 2 * x);
+        uint8x16x2_t bottomCells = vld2q_u8(bottom + 2 * x);
+        uint8x16_t cell[4] = { topCells.val[0], topCells.val[1], bottomCells.val[0], bottomCells.val[1] };
+
+        uint8x16_t red = vdupq_n_u8(0), blue = vdupq_n_u8(0);
+        uint8x16_t greens[2];
+        int numberOfGreens = 0;
+        for(int i = 0; i < 4; i++)
+        {
+            if(cellChannel[i] == Red) red = cell[i];
+            else if(cellChannel[i] == Blue) blue = cell[i];
+            else greens[numberOfGreens++] = cell[i];
+        }
+
+        uint8x16x3_t interleaved;
+        interleaved.val[0] = colorOrder == ColorOrder::RGB ? red : blue;
+        interleaved.val[1] = vrhaddq_u8(greens[0], greens[1]);
+        interleaved.val[2] = colorOrder == ColorOrder::RGB ? blue : red;
+        vst3q_u8(destination + 3 * x, interleaved);
+    }
+    return x;
+}
+
+#endif
+
+template <bool EdgeAware>
+void interpolateRows(const uint8_t* source, size_t sourceStride, int64_t width, int64_t height,
+                     BayerPattern pattern, ColorOrder colorOrder, InstructionSet instructionSet,
+                     uint8_t* destination, size_t destinationStride, int64_t firstRow, int64_t lastRow)
+{
+    int offsets[3];
+    channelOffsets(colorOrder, offsets);
+
+    for(int64_t y = firstRow; y < lastRow; y++)
+    {
+        const uint8_t* up = source + reflect101(y - 1, height) * sourceStride;
+        const uint8_t* row = source + y * sourceStride;
+        const uint8_t* down = source + reflect101(y + 1, height) * sourceStride;
+        uint8_t* output = destination + y * destinationStride;
+        RowPlan plan = planRow(pattern, y);
+
+        int64_t vectorEnd = 2;
+        switch(instructionSet)
+        {
+#if defined(DEMOSAIC_X86)
+            case InstructionSet::AVX2:
+                vectorEnd = interpolateRowAVX2<EdgeAware>(up, row, down, width, plan, colorOrder, output);
+                break;
+            case InstructionSet::SSE41:
+                vectorEnd = interpolateRowSSE41<EdgeAware>(up, row, down, width, plan, colorOrder, output);
+                break;
+#endif
+#if defined(DEMOSAIC_NEON)
+            case InstructionSet::NEON:
+                vectorEnd = interpolateRowNEON<EdgeAware>(up, row, down, width, plan, colorOrder, output);
+                break;
+#endif
+            default:
+                break;
+        }
+
+        for(int64_t x = 0; x < 2 && x < width; x++)
+        {
+            interpolatePixel<EdgeAware>(up, row, down, x, width, plan, offsets, output);
+        }
+        for(int64_t x = vectorEnd; x < width; x++)
+        {
+            interpolatePixel<EdgeAware>(up, row, down, x, width, plan, offsets, output);
+        }
+    }
+}
+
+void binRows(const uint8_t* source, size_t sourceStride, int64_t width,
+             BayerPattern pattern, ColorOrder colorOrder, InstructionSet instructionSet,
+             uint8_t* destination, size_t destinationStride, int64_t firstRow, int64_t lastRow)
+{
+    int offsets[3];
+    channelOffsets(colorOrder, offsets);
+
+    const int cellChannel[4] = { colorAt(pattern, 0, 0), colorAt(pattern, 1, 0),
+                                 colorAt(pattern, 0, 1), colorAt(pattern, 1, 1) };
+    int64_t outputWidth = width / 2;
+
+    for(int64_t y = firstRow; y < lastRow; y++)
+    {
+        const uint8_t* top = source + 2 * y * sourceStride;
+        const uint8_t* bottom = top + sourceStride;
+        uint8_t* output = destination + y * destinationStride;
+
+        int64_t vectorEnd = 0;
+        switch(instructionSet)
+        {
+#if defined(DEMOSAIC_X86)
+            case InstructionSet::AVX2:
+                vectorEnd = binRowAVX2(top, bottom, outputWidth, cellChannel, colorOrder, output);
+                break;
+            case InstructionSet::SSE41:
+                vectorEnd = binRowSSE41(top, bottom, outputWidth, cellChannel, colorOrder, output);
+                break;
+#endif
+#if defined(DEMOSAIC_NEON)
+            case InstructionSet::NEON:
+                vectorEnd = binRowNEON(top, bottom, outputWidth, cellChannel, colorOrder, output);
+                break;
+#endif
+            default:
+                break;
+        }
+
+        for(int64_t x = vectorEnd; x < outputWidth; x++)
+        {
+            const uint8_t cell[4] = { top[2 * x], top[2 * x + 1], bottom[2 * x], bottom[2 * x + 1] };
+            int green = -1;
+            uint8_t* pixel = output + 3 * x;
+            for(int i = 0; i < 4; i++)
+            {
+                if(cellChannel[i] != Green)
+                {
+                    pixel[offsets[cellChannel[i]]] = cell[i];
+                }
+                else if(green < 0)
+                {
+                    green = cell[i];
+                }
+                else
+                {
+                    pixel[offsets[Green]] = average2(green, cell[i]);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+BayerPattern bayerPatternFromPixelFormat(const std::string& pixelFormat)
+{
+    if(pixelFormat.compare(0, 7, "BayerBG") == 0) return BayerPattern::BG;
+    if(pixelFormat.compare(0, 7, "BayerGB") == 0) return BayerPattern::GB;
+    if(pixelFormat.compare(0, 7, "BayerGR") == 0) return BayerPattern::GR;
+    if(pixelFormat.compare(0, 7, "BayerRG") == 0) return BayerPattern::RG;
+    throw std::invalid_argument("Not a Bayer pixel format: " + pixelFormat);
+}
+
+DemosaicQuality demosaicQualityFromString(const std::string& quality)
+{
+    if(quality.compare("Binned") == 0) return DemosaicQuality::Binned;
+    if(quality.compare("Bilinear") == 0) return DemosaicQuality::Bilinear;
+    if(quality.compare("EdgeAware") == 0) return DemosaicQuality::EdgeAware;
+    throw std::invalid_argument("Unknown demosaic quality: " + quality);
+}
+
+InstructionSet bestInstructionSet()
+{
+#if defined(DEMOSAIC_NEON)
+    return InstructionSet::NEON;
+#elif defined(DEMOSAIC_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return InstructionSet::AVX2;
+    if(__builtin_cpu_supports("sse4.1")) return InstructionSet::SSE41;
+    return InstructionSet::Scalar;
+#elif defined(DEMOSAIC_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int highestLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osUsesXsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if(highestLeaf >= 7 && osUsesXsave && avx && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+        if(info[1] & (1 << 5)) return InstructionSet::AVX2;
+    }
+    return sse41 ? InstructionSet::SSE41 : InstructionSet::Scalar;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
+
+bool instructionSetSupported(InstructionSet instructionSet)
+{
+    switch(instructionSet)
+    {
+        case InstructionSet::Scalar:
+            return true;
+        case InstructionSet::NEON:
+#if defined(DEMOSAIC_NEON)
+            return true;
+#else
+            return false;
+#endif
+        case InstructionSet::SSE41:
+            return bestInstructionSet() == InstructionSet::SSE41 || bestInstructionSet() == InstructionSet::AVX2;
+        case InstructionSet::AVX2:
+            return bestInstructionSet() == InstructionSet::AVX2;
+    }
+    return false;
+}
+
+InstructionSet instructionSetFromString(const std::string& instructionSet)
+{
+    if(instructionSet.compare("Auto") == 0) return bestInstructionSet();
+    if(instructionSet.compare("Scalar") == 0) return InstructionSet::Scalar;
+    if(instructionSet.compare("SSE41") == 0) return InstructionSet::SSE41;
+    if(instructionSet.compare("AVX2") == 0) return InstructionSet::AVX2;
+    if(instructionSet.compare("NEON") == 0) return InstructionSet::NEON;
+    throw std::invalid_argument("Unknown instruction set: " + instructionSet);
+}
+
+const char* instructionSetName(InstructionSet instructionSet)
+{
+    switch(instructionSet)
+    {
+        case InstructionSet::Scalar: return "Scalar";
+        case InstructionSet::SSE41: return "SSE4.1";
+        case InstructionSet::AVX2: return "AVX2";
+        case InstructionSet::NEON: return "NEON";
+    }
+    return "Unknown";
+}
+
+Demosaicer::Demosaicer(DemosaicQuality quality, ColorOrder colorOrder, InstructionSet instructionSet) :
+                       m_quality(quality),
+                       m_colorOrder(colorOrder),
+                       m_instructionSet(instructionSetSupported(instructionSet) ? instructionSet : bestInstructionSet())
+{
+}
+
+void Demosaicer::outputSize(uint32_t width, uint32_t height, uint32_t& outputWidth, uint32_t& outputHeight) const
+{
+    if(m_quality == DemosaicQuality::Binned)
+    {
+        outputWidth = width / 2;
+        outputHeight = height / 2;
+    }
+    else
+    {
+        outputWidth = width;
+        outputHeight = height;
+    }
+}
+
+void Demosaicer::process(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                         BayerPattern pattern, uint8_t* destination, size_t destinationStride) const
+{
+    uint32_t outputWidth, outputHeight;
+    outputSize(width, height, outputWidth, outputHeight);
+    processRows(source, sourceStride, width, height, pattern, destination, destinationStride, 0, outputHeight);
+}
+
+void Demosaicer::processRows(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                             BayerPattern pattern, uint8_t* destination, size_t destinationStride,
+                             uint32_t firstRow, uint32_t lastRow) const
+{
+    if(width < 2 || height < 2)
+    {
+        throw std::invalid_argument("Demosaicing needs at least one complete 2x2 cell.");
+    }
+
+    switch(m_quality)
+    {
+        case DemosaicQuality::Binned:
+            binRows(source, sourceStride, width, pattern, m_colorOrder, m_instructionSet,
+                    destination, destinationStride, firstRow, lastRow);
+            break;
+        case DemosaicQuality::Bilinear:
+            interpolateRows<false>(source, sourceStride, width, height, pattern, m_colorOrder, m_instructionSet,
+                                   destination, destinationStride, firstRow, lastRow);
+            break;
+        case DemosaicQuality::EdgeAware:
+            interpolateRows<true>(source, sourceStride, width, height, pattern, m_colorOrder, m_instructionSet,
+                                  destination, destinationStride, firstRow, lastRow);
+            break;
+    }
+}
+
+void demosaicReference(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                       BayerPattern pattern, DemosaicQuality quality, ColorOrder colorOrder,
+                       uint8_t* destination, size_t destinationStride)
+{
+    int offsets[3];
+    channelOffsets(colorOrder, offsets);
+
+    auto sample = [&](int64_t x, int64_t y)
+    {
+        return (int) source[reflect101(y, height) * sourceStride + reflect101(x, width)];
+    };
+
+    if(quality == DemosaicQuality::Binned)
+    {
+        for(int64_t y = 0; y < height / 2; y++)
+        {
+            for(int64_t x = 0; x < width / 2; x++)
+            {
+                int sums[3] = { 0, 0, 0 };
+                int counts[3] = { 0, 0, 0 };
+                for(int64_t dy = 0; dy < 2; dy++)
+                {
+                    for(int64_t dx = 0; dx < 2; dx++)
+                    {
+                        int channel = colorAt(pattern, 2 * x + dx, 2 * y + dy);
+                        sums[channel] += sample(2 * x + dx, 2 * y + dy);
+                        counts[channel]++;
+                    }
+                }
+                for(int channel = 0; channel < 3; channel++)
+                {
+                    destination[y * destinationStride + 3 * x + offsets[channel]] =
+                        (uint8_t) ((sums[channel] + counts[channel] / 2) / counts[channel]);
+                }
+            }
+        }
+        return;
+    }
+
+    for(int64_t y = 0; y < height; y++)
+    {
+        for(int64_t x = 0; x < width; x++)
+        {
+            int site = colorAt(pattern, x, y);
+            for(int channel = 0; channel < 3; channel++)
+            {
+                int value;
+                if(channel == site)
+                {
+                    value = sample(x, y);
+                }
+                else if(quality == DemosaicQuality::EdgeAware && channel == Green)
+                {
+                    value = edgeAwareGreen(sample(x - 1, y), sample(x + 1, y), sample(x, y - 1), sample(x, y + 1));
+                }
+                else
+                {
+                    // Average of all samples of this color in the 3x3 neighborhood.
+                    int sum = 0, count = 0;
+                    for(int64_t dy = -1; dy <= 1; dy++)
+                    {
+                        for(int64_t dx = -1; dx <= 1; dx++)
+                        {
+                            if(colorAt(pattern, x + dx, y + dy) == channel)
+                            {
+                                sum += sample(x + dx, y + dy);
+                                count++;
+                            }
+                        }
+                    }
+                    value = (sum + count / 2) / count;
+                }
+                destination[y * destinationStride + 3 * x + offsets[channel]] = (uint8_t) value;
+            }
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef DEMOSAIC_HPP
+#define DEMOSAIC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+    Color filter layouts, named after the top left 2x2 cell the way GenICam (and Pylon's
+    PixelFormat) does it: BG means the first row starts with blue, green.
+    Note that OpenCV's COLOR_Bayer* codes are named after the second row instead.
+*/
+enum class BayerPattern
+{
+    BG,
+    GB,
+    GR,
+    RG
+};
+
+enum class DemosaicQuality
+{
+    Binned,     // Every 2x2 cell becomes one pixel, half the resolution in each direction.
+    Bilinear,   // Missing colors are the average of the nearest samples of that color.
+    EdgeAware   // Like Bilinear, but green is interpolated along edges instead of across them.
+};
+
+enum class ColorOrder
+{
+    RGB,
+    BGR
+};
+
+enum class InstructionSet
+{
+    Scalar,
+    SSE41,
+    AVX2,
+    NEON
+};
+
+BayerPattern bayerPatternFromPixelFormat(const std::string& pixelFormat);
+DemosaicQuality demosaicQualityFromString(const std::string& quality);
+InstructionSet bestInstructionSet();
+bool instructionSetSupported(InstructionSet instructionSet);
+// "Auto" picks the best instruction set of the CPU we are running on.
+InstructionSet instructionSetFromString(const std::string& instructionSet);
+const char* instructionSetName(InstructionSet instructionSet);
+
+/*
+    Converts 8 bit Bayer images into interleaved 3 channel images, written straight into the
+    destination buffer. Image borders are handled by mirroring, which keeps the filter phase.
+    The kernel for the instruction set is picked once at construction, all kernels produce the
+    same bytes as demosaicReference().
+*/
+class Demosaicer
+{
+public:
+    Demosaicer(DemosaicQuality quality, ColorOrder colorOrder,
+               InstructionSet instructionSet = bestInstructionSet());
+
+    // Size of the output for a width x height input.
+    void outputSize(uint32_t width, uint32_t height, uint32_t& outputWidth, uint32_t& outputHeight) const;
+
+    void process(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                 BayerPattern pattern, uint8_t* destination, size_t destinationStride) const;
+
+    /*
+        Only produces output rows firstRow..lastRow-1, still taking the neighborhood from the full
+        source image. Bands processed this way in parallel give exactly the same bytes as process().
+        destination points to output row 0, not to firstRow.
+    */
+    void processRows(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                     BayerPattern pattern, uint8_t* destination, size_t destinationStride,
+                     uint32_t firstRow, uint32_t lastRow) const;
+
+    DemosaicQuality quality() const { return m_quality; }
+    InstructionSet instructionSet() const { return m_instructionSet; }
+
+private:
+    DemosaicQuality m_quality;
+    ColorOrder m_colorOrder;
+    InstructionSet m_instructionSet;
+};
+
+/*
+    Straightforward per pixel implementation of every quality tier. Slow, only meant as the
+    ground truth the vectorized kernels are checked against.
+*/
+void demosaicReference(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                       BayerPattern pattern, DemosaicQuality quality, ColorOrder colorOrder,
+                       uint8_t* destination, size_t destinationStride);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "framebufferpool.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+FrameBufferPool::FrameBufferPool(size_t numberOfBuffers, size_t bufferSize, bool hugePages) :
+                                 m_hugePages(hugePages),
+                                 m_bufferSize(bufferSize),
+                                 m_misses(0)
+{
+    m_free.reserve(numberOfBuffers);
+    for(size_t i = 0; i < numberOfBuffers; i++)
+    {
+        m_free.emplace_back();
+        allocate(m_free.back(), bufferSize);
+    }
+}
+
+void FrameBufferPool::allocate(std::vector<uint8_t>& buffer, size_t bufferSize)
+{
+    std::vector<uint8_t>().swap(buffer);
+    // Reserving does not touch the pages yet, so the advice still decides how they are backed.
+    buffer.reserve(bufferSize);
+    adviseHugePages(buffer);
+    buffer.resize(bufferSize);
+}
+
+void FrameBufferPool::adviseHugePages(std::vector<uint8_t>& buffer)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if(!m_hugePages)
+    {
+        return;
+    }
+    // Only whole huge pages inside the buffer can be backed by one.
+    uintptr_t begin = ((uintptr_t) buffer.data() + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1);
+    uintptr_t end = ((uintptr_t) buffer.data() + buffer.capacity()) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1);
+    if(begin < end)
+    {
+        madvise((void*) begin, end - begin, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+void FrameBufferPool::acquire(std::vector<uint8_t>& data, size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_free.empty())
+        {
+            std::vector<uint8_t>& buffer = m_free[closestFit(size)];
+            data.swap(buffer);
+            buffer.swap(m_free.back());
+            m_free.pop_back();
+        }
+        else
+        {
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        if(size > m_bufferSize)
+        {
+            // The smaller buffers are replaced as they come back.
+            m_bufferSize = size;
+        }
+    }
+    data.resize(size);
+}
+
+/*
+    The free buffer that needs the fewest bytes written to hold size bytes: growing a vector
+    zeroes every byte it grows by, shrinking it writes nothing. Buffers settle on the sizes of
+    the frames they carry, so frames of alternating sizes each find one that fits exactly.
+*/
+size_t FrameBufferPool::closestFit(size_t size) const
+{
+    size_t best = m_free.size() - 1;
+    for(size_t i = 0; i < m_free.size(); i++)
+    {
+        size_t current = m_free[i].size();
+        size_t bestSize = m_free[best].size();
+        if(current == size)
+        {
+            return i;
+        }
+        if(current > size ? bestSize < size || current < bestSize : bestSize < size && current > bestSize)
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void FrameBufferPool::release(std::vector<uint8_t>& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_free.size() < m_free.capacity())
+    {
+        if(data.capacity() < m_bufferSize)
+        {
+            // Handed out before the frames got larger, replaced once.
+            allocate(data, m_bufferSize);
+        }
+        m_free.emplace_back();
+        m_free.back().swap(data);
+        return;
+    }
+    std::vector<uint8_t>().swap(data);
+}
+
+void FrameBufferPool::grow(size_t bufferSize)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(bufferSize <= m_bufferSize)
+    {
+        return;
+    }
+    m_bufferSize = bufferSize;
+    for(std::vector<uint8_t>& buffer : m_free)
+    {
+        allocate(buffer, bufferSize);
+    }
+}
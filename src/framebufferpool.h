@@ -0,0 +1,66 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMEBUFFERPOOL_HPP
+#define FRAMEBUFFERPOOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Buffers on top of the frames that can be in flight at once, for the one being converted
+// while the oldest is still being published.
+#define FRAME_BUFFER_POOL_SPARE 2
+
+/*
+    Pixel buffers for the images of one camera, allocated and touched once at start-up and
+    then passed around by swapping them in and out of link_dev::ImageT::data, so that the
+    conversion of a frame neither allocates nor page faults. A buffer goes back to the pool
+    when the ConvertedFrame holding it is done (see ConvertedFrame::returnBuffer()).
+
+    If more frames are in flight than there are buffers, acquire() hands out an empty vector
+    that allocates like before and counts a miss; released buffers beyond the pool's size are
+    freed. A frame larger than the buffers grows them once and the pool adopts the new size,
+    smaller frames keep using the buffers as they are. acquire() picks the buffer that was last
+    used for frames of the same size, so that frames of alternating sizes do not zero the
+    difference every time.
+*/
+class FrameBufferPool
+{
+public:
+    // With hugePages the buffers are backed by transparent huge pages where the kernel has them.
+    FrameBufferPool(size_t numberOfBuffers, size_t bufferSize, bool hugePages = false);
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    // Swaps a pooled buffer of at least size bytes into data, which has to be empty.
+    void acquire(std::vector<uint8_t>& data, size_t size);
+    // Takes the storage of data back, data is left empty either way.
+    void release(std::vector<uint8_t>& data);
+    // Reallocates the buffers if frames of bufferSize bytes no longer fit, e.g. after the
+    // camera's region of interest was changed. Buffers handed out are replaced as they come back.
+    void grow(size_t bufferSize);
+
+    uint64_t missCount() const { return m_misses.load(std::memory_order_relaxed); }
+
+private:
+    void allocate(std::vector<uint8_t>& buffer, size_t bufferSize);
+    size_t closestFit(size_t size) const;
+    void adviseHugePages(std::vector<uint8_t>& buffer);
+
+    bool m_hugePages;
+    std::mutex m_mutex;
+    size_t m_bufferSize;
+    // Reserved for all buffers up front, so that release() never reallocates it.
+    std::vector<std::vector<uint8_t>> m_free;
+    std::atomic<uint64_t> m_misses;
+};
+
+#endif
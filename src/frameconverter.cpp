@@ -0,0 +1,139 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "frameconverter.h"
+
+bool convertFrame(RawFrame& rawFrame, ConvertedFrame& convertedFrame,
+                  link_dev::Format imageFormat, const Demosaicer& demosaicer, BayerPattern bayerPattern,
+                  FrameReducer& reducer, const Unpacker* unpacker, FrameBufferPool& bufferPool,
+                  WorkerPool& conversionPool)
+{
+    size_t numberOfPixels = (size_t) rawFrame.width * rawFrame.height;
+
+    if(unpacker != nullptr)
+    {
+        convertedFrame.image.width = rawFrame.width;
+        convertedFrame.image.height = rawFrame.height;
+        convertedFrame.borrowPoolBuffer(bufferPool, numberOfPixels * sizeof(uint16_t));
+        uint16_t* destination = (uint16_t*) convertedFrame.image.data.data();
+
+        // Bands start on even pixels, where a packed pair starts.
+        size_t numberOfBands = conversionPool.numberOfThreads();
+        size_t pixelsPerBand = ((numberOfPixels + numberOfBands - 1) / numberOfBands + 1) & ~(size_t) 1;
+
+        conversionPool.parallelFor(numberOfBands, [&](size_t band)
+        {
+            size_t firstPixel = band * pixelsPerBand;
+            size_t lastPixel = std::min(numberOfPixels, firstPixel + pixelsPerBand);
+            if(firstPixel < lastPixel)
+            {
+                unpacker->process(rawFrame.buffer, destination, firstPixel, lastPixel);
+            }
+        });
+        return true;
+    }
+
+    const uint8_t* source = rawFrame.buffer;
+    uint32_t width = rawFrame.width;
+    uint32_t height = rawFrame.height;
+
+    if(reducer.active())
+    {
+        uint32_t reducedWidth, reducedHeight;
+        reducer.outputSize(rawFrame.width, rawFrame.height, reducedWidth, reducedHeight);
+
+        if(imageFormat == link_dev::Format_GRAY_U8)
+        {
+            // Nothing to demosaic, the reduced frame is the image.
+            convertedFrame.image.width = reducedWidth;
+            convertedFrame.image.height = reducedHeight;
+            convertedFrame.image.format = link_dev::Format_GRAY_U8;
+            convertedFrame.borrowPoolBuffer(bufferPool, (size_t) reducedWidth * reducedHeight);
+            reducer.process(rawFrame.buffer, rawFrame.width, rawFrame.width, rawFrame.height,
+                            convertedFrame.image.data.data(), conversionPool);
+            return true;
+        }
+
+        std::vector<uint8_t>& scratch = reducer.scratch();
+        scratch.resize((size_t) reducedWidth * reducedHeight);
+        reducer.process(rawFrame.buffer, rawFrame.width, rawFrame.width, rawFrame.height, scratch.data(), conversionPool);
+        source = scratch.data();
+        width = reducedWidth;
+        height = reducedHeight;
+    }
+
+    if(imageFormat == link_dev::Format_GRAY_U8 && rawFrame.bufferFactory != nullptr &&
+       rawFrame.bufferFactory->lendable(rawFrame.bufferContext, numberOfPixels))
+    {
+        // Mono8 is already what goes out on the mesh. The grab buffer becomes the image data
+        // and the only copy left is the one made while serializing.
+        convertedFrame.image.width = rawFrame.width;
+        convertedFrame.image.height = rawFrame.height;
+        convertedFrame.image.format = link_dev::Format_GRAY_U8;
+        convertedFrame.borrowGrabBuffer(rawFrame, numberOfPixels);
+    }
+    else if(imageFormat == link_dev::Format_GRAY_U8)
+    {
+        convertedFrame.image.width = rawFrame.width;
+        convertedFrame.image.height = rawFrame.height;
+        convertedFrame.image.format = link_dev::Format_GRAY_U8;
+        convertedFrame.borrowPoolBuffer(bufferPool, numberOfPixels);
+        memcpy(convertedFrame.image.data.data(), rawFrame.buffer, numberOfPixels);
+    }
+    else
+    {
+        uint32_t outputWidth, outputHeight;
+        demosaicer.outputSize(width, height, outputWidth, outputHeight);
+
+        convertedFrame.image.width = outputWidth;
+        convertedFrame.image.height = outputHeight;
+        convertedFrame.image.format = imageFormat;
+        convertedFrame.borrowPoolBuffer(bufferPool, (size_t) outputWidth * outputHeight * 3);
+
+        // One band of rows per thread. Every band reads its neighborhood from the whole frame,
+        // so the rows at the band borders come out the same as without splitting.
+        size_t numberOfBands = conversionPool.numberOfThreads();
+        uint32_t rowsPerBand = (uint32_t) ((outputHeight + numberOfBands - 1) / numberOfBands);
+        uint8_t* destination = convertedFrame.image.data.data();
+
+        conversionPool.parallelFor(numberOfBands, [&](size_t band)
+        {
+            uint32_t firstRow = (uint32_t) band * rowsPerBand;
+            uint32_t lastRow = std::min(outputHeight, firstRow + rowsPerBand);
+            if(firstRow < lastRow)
+            {
+                demosaicer.processRows(source, width, width, height, bayerPattern,
+                                       destination, (size_t) outputWidth * 3, firstRow, lastRow);
+            }
+        });
+    }
+    return true;
+}
+
+size_t convertedImageSize(uint32_t width, uint32_t height, link_dev::Format imageFormat,
+                          const Demosaicer& demosaicer, const FrameReducer& reducer, const Unpacker* unpacker)
+{
+    if(unpacker != nullptr)
+    {
+        return (size_t) width * height * sizeof(uint16_t);
+    }
+    uint32_t reducedWidth = width, reducedHeight = height;
+    if(reducer.active())
+    {
+        reducer.outputSize(width, height, reducedWidth, reducedHeight);
+    }
+    if(imageFormat == link_dev::Format_GRAY_U8)
+    {
+        return (size_t) reducedWidth * reducedHeight;
+    }
+    uint32_t outputWidth, outputHeight;
+    demosaicer.outputSize(reducedWidth, reducedHeight, outputWidth, outputHeight);
+    return (size_t) outputWidth * outputHeight * 3;
+}
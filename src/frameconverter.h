@@ -0,0 +1,38 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMECONVERTER_HPP
+#define FRAMECONVERTER_HPP
+
+#include "demosaic.h"
+#include "framepipeline.h"
+#include "framereducer.h"
+#include "unpack.h"
+#include "workerpool.h"
+#include "Image_generated.h"
+
+/*
+    Turns one raw grab buffer into the Image that goes out on the mesh. Runs either inline on the
+    grab thread or on the convert stage of the FramePipeline. If the reducer is active the frame
+    is cropped, binned or decimated first, so that the demosaic only runs on what is left.
+
+    If an unpacker is given the frame holds packed pixels instead. They are unpacked to one
+    uint16_t per pixel in image.data and nothing else is done to them; imageFormat, the
+    demosaicer and the reducer are not used.
+
+    Unless the grab buffer itself becomes the image, image.data is taken from bufferPool.
+*/
+bool convertFrame(RawFrame& rawFrame, ConvertedFrame& convertedFrame,
+                  link_dev::Format imageFormat, const Demosaicer& demosaicer, BayerPattern bayerPattern,
+                  FrameReducer& reducer, const Unpacker* unpacker, FrameBufferPool& bufferPool,
+                  WorkerPool& conversionPool);
+
+// Bytes of image.data convertFrame() produces from a frame of width x height pixels.
+size_t convertedImageSize(uint32_t width, uint32_t height, link_dev::Format imageFormat,
+                          const Demosaicer& demosaicer, const FrameReducer& reducer, const Unpacker* unpacker);
+
+#endif
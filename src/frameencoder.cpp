@@ -0,0 +1,210 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include "frameencoder.h"
+#include "workerpool.h"
+
+Codec codecFromString(const std::string& codec)
+{
+    if(codec.compare("None") == 0)
+    {
+        return Codec::None;
+    }
+    else if(codec.compare("JPEG") == 0)
+    {
+        return Codec::JPEG;
+    }
+    else if(codec.compare("PNG") == 0)
+    {
+        return Codec::PNG;
+    }
+    throw std::invalid_argument("Unknown compression: " + codec);
+}
+
+FrameEncoder::FrameEncoder(const CompressionSettings& settings, PublishFunction publish) :
+                           m_settings(settings),
+                           m_publish(publish)
+{
+    size_t threads = std::max<size_t>(m_settings.threads, 1);
+    for(size_t i = 0; i < threads; i++)
+    {
+        int core = m_settings.threadAffinity.empty() ? -1 : m_settings.threadAffinity[i % m_settings.threadAffinity.size()];
+        m_encoders.push_back(std::thread(&FrameEncoder::encoderLoop, this, core));
+    }
+}
+
+FrameEncoder::~FrameEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for(std::thread& encoder : m_encoders)
+    {
+        encoder.join();
+    }
+}
+
+void FrameEncoder::submit(ConvertedFrame&& frame)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_jobs.size() >= m_settings.queueDepth)
+    {
+        // The dropped frame leaves a hole in the sequence that must not hold up the ones after it.
+        uint64_t dropped = m_jobs.front().sequence;
+        m_jobs.pop_front();
+        m_droppedCount++;
+        finish(dropped, nullptr, lock);
+    }
+
+    m_jobs.push_back(Job{m_nextSequence++, std::move(frame)});
+    lock.unlock();
+    m_jobAvailable.notify_one();
+}
+
+uint64_t FrameEncoder::droppedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_droppedCount;
+}
+
+void FrameEncoder::encoderLoop(int core)
+{
+    if(core >= 0 && !pinCurrentThreadToCore(core))
+    {
+        std::cerr << "Could not pin encoder thread to core " << core << "." << std::endl;
+    }
+
+    // Only needed to swap red and blue, kept from frame to frame.
+    std::vector<uint8_t> scratch;
+
+    for(;;)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+        // Frames submitted before the encoder was destroyed are still encoded and published.
+        if(m_jobs.empty())
+        {
+            return;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        lock.unlock();
+
+        std::unique_ptr<link_dev::basler::CompressedImageT> result;
+        try
+        {
+            result = encode(job.frame, scratch);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Encoding a frame failed: " << e.what() << std::endl;
+        }
+        job.frame.returnBuffer();
+
+        lock.lock();
+        finish(job.sequence, std::move(result), lock);
+    }
+}
+
+std::unique_ptr<link_dev::basler::CompressedImageT> FrameEncoder::encode(ConvertedFrame& frame, std::vector<uint8_t>& scratch) const
+{
+    link_dev::ImageT& image = frame.image;
+    int type = image.format == link_dev::Format_GRAY_U8 ? CV_8UC1 : CV_8UC3;
+
+    // Wraps the converted pixels, nothing is copied.
+    cv::Mat pixels((int) image.height, (int) image.width, type, image.data.data());
+
+    if(image.format == link_dev::Format_RGB_U8)
+    {
+        // OpenCV encodes three channel images as BGR.
+        scratch.resize(image.data.size());
+        cv::Mat swapped((int) image.height, (int) image.width, CV_8UC3, scratch.data());
+        cv::cvtColor(pixels, swapped, cv::COLOR_RGB2BGR);
+        pixels = swapped;
+    }
+
+    std::unique_ptr<link_dev::basler::CompressedImageT> result(new link_dev::basler::CompressedImageT());
+    result->camera_timestamp = frame.info.cameraTimestamp;
+    result->width = image.width;
+    result->height = image.height;
+    result->format = image.format;
+    if(frame.info.hasChunks)
+    {
+        result->metadata.reset(new link_dev::basler::FrameMetadata(frameMetadataOf(frame.info)));
+    }
+
+    std::vector<int> parameters;
+    const char* extension;
+    if(m_settings.codec == Codec::JPEG)
+    {
+        result->codec = "jpeg";
+        extension = ".jpg";
+        parameters = { cv::IMWRITE_JPEG_QUALITY, m_settings.jpegQuality };
+    }
+    else
+    {
+        result->codec = "png";
+        extension = ".png";
+        parameters = { cv::IMWRITE_PNG_COMPRESSION, PNG_COMPRESSION_LEVEL };
+    }
+
+    // Encodes straight into the vector that gets serialized.
+    if(!cv::imencode(extension, pixels, result->data, parameters))
+    {
+        throw std::runtime_error("cv::imencode refused the frame");
+    }
+    return result;
+}
+
+/*
+    Called with the lock held. Publishes every frame that is now next in line. Only one thread
+    publishes at a time; whoever is publishing also picks up what other threads finish meanwhile.
+*/
+void FrameEncoder::finish(uint64_t sequence, std::unique_ptr<link_dev::basler::CompressedImageT> result,
+                          std::unique_lock<std::mutex>& lock)
+{
+    m_finished[sequence] = std::move(result);
+    if(m_publishing)
+    {
+        return;
+    }
+
+    m_publishing = true;
+    while(!m_finished.empty() && m_finished.begin()->first == m_nextToPublish)
+    {
+        std::unique_ptr<link_dev::basler::CompressedImageT> next = std::move(m_finished.begin()->second);
+        m_finished.erase(m_finished.begin());
+        m_nextToPublish++;
+
+        if(next)
+        {
+            lock.unlock();
+            try
+            {
+                m_publish(*next);
+            }
+            catch(const std::exception& e)
+            {
+                std::cerr << "Publishing a compressed frame failed: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    }
+    m_publishing = false;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMEENCODER_HPP
+#define FRAMEENCODER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framepipeline.h"
+#include "CompressedImage_generated.h"
+
+#define DEFAULT_JPEG_QUALITY 90
+// zlib level 1: PNG stays lossless, but encodes several times faster than the default.
+#define PNG_COMPRESSION_LEVEL 1
+
+enum class Codec
+{
+    None,
+    JPEG,
+    PNG
+};
+
+Codec codecFromString(const std::string& codec);
+
+struct CompressionSettings
+{
+    Codec codec = Codec::None;
+    int jpegQuality = DEFAULT_JPEG_QUALITY;
+    size_t threads = 2;
+    std::vector<int> threadAffinity;
+    // Frames waiting for an encoder. When full, the oldest waiting frame is dropped.
+    size_t queueDepth = DEFAULT_PIPELINE_QUEUE_DEPTH;
+    // Keep publishing the uncompressed images next to the compressed ones.
+    bool publishUncompressed = true;
+};
+
+/*
+    Encodes frames on a set of threads, one frame per thread at a time, so that throughput
+    scales with the number of threads while every single frame is encoded by one libjpeg or
+    libpng call. Encoded frames can finish out of order; they are put back in the order they
+    were submitted before they are handed to the publish function.
+
+    The encoder takes the ConvertedFrame over and reads its pixels in place. A lent grab buffer
+    goes back to Pylon once the frame is encoded. The destructor waits until the frames still
+    queued are encoded and published.
+*/
+class FrameEncoder
+{
+public:
+    using PublishFunction = std::function<void(link_dev::basler::CompressedImageT&)>;
+
+    FrameEncoder(const CompressionSettings& settings, PublishFunction publish);
+    ~FrameEncoder();
+
+    FrameEncoder(const FrameEncoder&) = delete;
+    FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+    void submit(ConvertedFrame&& frame);
+
+    uint64_t droppedCount() const;
+
+private:
+    struct Job
+    {
+        uint64_t sequence;
+        ConvertedFrame frame;
+    };
+
+    void encoderLoop(int core);
+    std::unique_ptr<link_dev::basler::CompressedImageT> encode(ConvertedFrame& frame, std::vector<uint8_t>& scratch) const;
+    void finish(uint64_t sequence, std::unique_ptr<link_dev::basler::CompressedImageT> result,
+                std::unique_lock<std::mutex>& lock);
+
+    CompressionSettings m_settings;
+    PublishFunction m_publish;
+    std::vector<std::thread> m_encoders;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::deque<Job> m_jobs;
+    bool m_stopping = false;
+    uint64_t m_nextSequence = 0;
+    uint64_t m_droppedCount = 0;
+
+    // Encoded (or, as nullptr, dropped) frames that wait for an earlier one.
+    std::map<uint64_t, std::unique_ptr<link_dev::basler::CompressedImageT>> m_finished;
+    uint64_t m_nextToPublish = 0;
+    bool m_publishing = false;
+};
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <chrono>
+#include <iostream>
+#include "framepipeline.h"
+
+link_dev::basler::FrameMetadata frameMetadataOf(const FrameInfo& info)
+{
+    return link_dev::basler::FrameMetadata(info.cameraTimestamp,
+                                           info.hostTimestamp,
+                                           info.exposureTimeUs,
+                                           info.gainRaw,
+                                           info.frameCounter);
+}
+
+ConvertedFrame::ConvertedFrame(ConvertedFrame&& other) :
+                               info(other.info),
+                               image(std::move(other.image)),
+                               grabResult(other.grabResult),
+                               m_lender(other.m_lender),
+                               m_lentBuffer(other.m_lentBuffer),
+                               m_pool(other.m_pool)
+{
+    other.m_lender = nullptr;
+    other.m_pool = nullptr;
+    other.grabResult.Release();
+}
+
+ConvertedFrame& ConvertedFrame::operator=(ConvertedFrame&& other)
+{
+    if(this != &other)
+    {
+        returnBuffer();
+        info = other.info;
+        image = std::move(other.image);
+        grabResult = other.grabResult;
+        m_lender = other.m_lender;
+        m_lentBuffer = other.m_lentBuffer;
+        m_pool = other.m_pool;
+        other.m_lender = nullptr;
+        other.m_pool = nullptr;
+        other.grabResult.Release();
+    }
+    return *this;
+}
+
+ConvertedFrame::~ConvertedFrame()
+{
+    returnBuffer();
+}
+
+void ConvertedFrame::borrowGrabBuffer(RawFrame& rawFrame, size_t imageSize)
+{
+    returnBuffer();
+
+    grabResult = rawFrame.grabResult;
+    m_lender = rawFrame.bufferFactory;
+    m_lentBuffer = rawFrame.bufferContext;
+    m_lender->lend(m_lentBuffer, image.data);
+    // Shrinking never reallocates, so the buffer Pylon knows about stays where it is.
+    image.data.resize(imageSize);
+}
+
+void ConvertedFrame::borrowPoolBuffer(FrameBufferPool& pool, size_t imageSize)
+{
+    returnBuffer();
+
+    // Whatever image.data held before is not needed, the pool wants an empty vector.
+    std::vector<uint8_t>().swap(image.data);
+    pool.acquire(image.data, imageSize);
+    m_pool = &pool;
+}
+
+void ConvertedFrame::returnBuffer()
+{
+    if(m_lender != nullptr)
+    {
+        m_lender->giveBack(m_lentBuffer, image.data);
+        m_lender = nullptr;
+    }
+    if(m_pool != nullptr)
+    {
+        m_pool->release(image.data);
+        m_pool = nullptr;
+    }
+    // Only now may Pylon queue the buffer for the next grab.
+    grabResult.Release();
+}
+
+FramePipeline::FramePipeline(const PipelineSettings& settings,
+                             ConvertFunction convert,
+                             PublishFunction publish) :
+                             m_convert(convert),
+                             m_publish(publish),
+                             m_convertQueue(settings.convertQueueDepth, settings.convertQueueOverflowPolicy),
+                             m_publishQueue(settings.publishQueueDepth, settings.publishQueueOverflowPolicy),
+                             m_running(false),
+                             m_converted(0),
+                             m_handedOver(0),
+                             m_published(0),
+                             m_draining(false)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+void FramePipeline::start()
+{
+    if(m_running.exchange(true))
+    {
+        return;
+    }
+
+    m_publishThread = std::thread(&FramePipeline::publishLoop, this);
+    m_convertThread = std::thread(&FramePipeline::convertLoop, this);
+}
+
+void FramePipeline::stop()
+{
+    if(!m_running.exchange(false))
+    {
+        return;
+    }
+
+    // Stop from the front so that every stage sees its input closed before its output.
+    m_convertQueue.close();
+    m_convertThread.join();
+    m_publishQueue.close();
+    m_publishThread.join();
+}
+
+bool FramePipeline::submit(RawFrame&& frame)
+{
+    m_submitted++;
+    return m_convertQueue.push(std::move(frame));
+}
+
+void FramePipeline::drain()
+{
+    if(!m_running.load())
+    {
+        return;
+    }
+    // Pairs with the fence in stageAdvanced(): either a stage sees that drain() waits, or
+    // drain() sees what the stage counted before it waits.
+    m_draining.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(m_drainMutex);
+        m_stageAdvanced.wait(lock, [this] { return drained(); });
+    }
+    m_draining.store(false, std::memory_order_relaxed);
+}
+
+bool FramePipeline::drained() const
+{
+    // Nothing is submitted while the grab thread waits in drain(). Once the convert stage has
+    // seen every frame, nothing more is handed over to the publish stage either.
+    return m_converted.load() + m_convertQueue.droppedCount() >= m_submitted &&
+           m_published.load() + m_publishQueue.droppedCount() >= m_handedOver.load();
+}
+
+// Called by the stages after they counted a frame.
+void FramePipeline::stageAdvanced()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_draining.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(m_drainMutex);
+        m_stageAdvanced.notify_one();
+    }
+}
+
+void FramePipeline::convertLoop()
+{
+    RawFrame rawFrame;
+
+    for(;;)
+    {
+        // A closed ring still hands out what was queued, so every frame submitted before stop()
+        // is converted. Nothing is submitted after the close.
+        bool closed = m_convertQueue.isClosed();
+        if(!m_convertQueue.pop(rawFrame, std::chrono::milliseconds(PIPELINE_POP_TIMEOUT_MS)))
+        {
+            if(closed)
+            {
+                break;
+            }
+            continue;
+        }
+
+        ConvertedFrame convertedFrame;
+        convertedFrame.info = rawFrame.info;
+        bool converted = false;
+        try
+        {
+            converted = m_convert(rawFrame, convertedFrame);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Frame conversion failed: " << e.what() << std::endl;
+        }
+
+        // Hand the grab buffer back to Pylon as early as possible.
+        rawFrame = RawFrame();
+
+        if(converted)
+        {
+            m_handedOver++;
+            m_publishQueue.push(std::move(convertedFrame));
+        }
+        m_converted++;
+        stageAdvanced();
+    }
+}
+
+void FramePipeline::publishLoop()
+{
+    ConvertedFrame convertedFrame;
+
+    for(;;)
+    {
+        // Closed only after the convert stage is done, the frames it handed over are all published.
+        bool closed = m_publishQueue.isClosed();
+        if(!m_publishQueue.pop(convertedFrame, std::chrono::milliseconds(PIPELINE_POP_TIMEOUT_MS)))
+        {
+            if(closed)
+            {
+                break;
+            }
+            continue;
+        }
+
+        try
+        {
+            m_publish(convertedFrame);
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Publishing a frame failed: " << e.what() << std::endl;
+        }
+        convertedFrame.returnBuffer();
+        m_published++;
+        stageAdvanced();
+    }
+}
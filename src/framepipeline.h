@@ -0,0 +1,163 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMEPIPELINE_HPP
+#define FRAMEPIPELINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <pylon/PylonIncludes.h>
+
+#include "framebufferpool.h"
+#include "grabbufferfactory.h"
+#include "spscring.h"
+#include "FrameMetadata_generated.h"
+#include "Image_generated.h"
+
+#define DEFAULT_PIPELINE_QUEUE_DEPTH 4
+#define PIPELINE_POP_TIMEOUT_MS 100
+
+struct PipelineSettings
+{
+    bool enabled = false;
+    size_t convertQueueDepth = DEFAULT_PIPELINE_QUEUE_DEPTH;
+    OverflowPolicy convertQueueOverflowPolicy = OverflowPolicy::DropOldest;
+    size_t publishQueueDepth = DEFAULT_PIPELINE_QUEUE_DEPTH;
+    OverflowPolicy publishQueueOverflowPolicy = OverflowPolicy::DropOldest;
+};
+
+// Facts about a frame that travel with it through all stages.
+struct FrameInfo
+{
+    uint64_t cameraTimestamp = 0;   // GetTimeStamp() of the grab result, in camera ticks.
+    int64_t grabId = 0;             // Counts up with every grab result, failed ones included.
+    uint64_t skippedImages = 0;     // Images the grab strategy dropped right before this one.
+    int64_t retrieveTime = 0;       // steady_clock nanoseconds when RetrieveResult returned it.
+    int64_t convertStart = 0;       // The same clock, when the convert stage picked it up,
+    int64_t convertEnd = 0;         // when the image was ready
+    int64_t publishStart = 0;       // and when serializing and pushing it began.
+
+    // From the chunks the camera appended to the image, only if hasChunks.
+    bool hasChunks = false;
+    double exposureTimeUs = 0;
+    int64_t gainRaw = 0;
+    uint64_t frameCounter = 0;
+    // cameraTimestamp on the host's system clock, 0 if the camera clock is not mapped.
+    int64_t hostTimestamp = 0;
+};
+
+link_dev::basler::FrameMetadata frameMetadataOf(const FrameInfo& info);
+
+/*
+    A frame as it comes out of the grab engine. The grab result is held until the convert
+    stage is done with the buffer, after that it goes back to Pylon.
+*/
+struct RawFrame
+{
+    FrameInfo info;
+    Pylon::CGrabResultPtr grabResult;
+    uint8_t* buffer = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Set if the buffer was allocated by a GrabBufferFactory and may be lent to the output image.
+    GrabBufferFactory* bufferFactory = nullptr;
+    intptr_t bufferContext = 0;
+};
+
+/*
+    The Image about to be published. If the image pixels are a grab buffer lent by a
+    GrabBufferFactory, the frame also keeps the grab result alive and gives the storage back
+    when it is done with it, whether it was published, dropped from a queue or destroyed.
+    Pixels taken from a FrameBufferPool go back to the pool the same way.
+*/
+struct ConvertedFrame
+{
+    FrameInfo info;
+    link_dev::ImageT image;
+    Pylon::CGrabResultPtr grabResult;
+
+    ConvertedFrame() = default;
+    ConvertedFrame(ConvertedFrame&& other);
+    ConvertedFrame& operator=(ConvertedFrame&& other);
+    ~ConvertedFrame();
+
+    // Moves the pixels of a grab buffer into image.data without copying them.
+    void borrowGrabBuffer(RawFrame& rawFrame, size_t imageSize);
+    // Makes image.data a buffer of imageSize bytes from the pool.
+    void borrowPoolBuffer(FrameBufferPool& pool, size_t imageSize);
+    void returnBuffer();
+
+private:
+    GrabBufferFactory* m_lender = nullptr;
+    intptr_t m_lentBuffer = 0;
+    FrameBufferPool* m_pool = nullptr;
+};
+
+/*
+    Grab -> convert -> publish, with the convert and publish stages each running on their own
+    thread and bounded SpscRings in between. The grab thread only ever calls submit(), which
+    never waits unless a ring was configured with OverflowPolicy::Block.
+*/
+class FramePipeline
+{
+public:
+    using ConvertFunction = std::function<bool(RawFrame&, ConvertedFrame&)>;
+    using PublishFunction = std::function<void(ConvertedFrame&)>;
+
+    FramePipeline(const PipelineSettings& settings,
+                  ConvertFunction convert,
+                  PublishFunction publish);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    void start();
+    void stop();
+
+    // Called from the grab thread. Returns false if a frame was dropped on the way in.
+    bool submit(RawFrame&& frame);
+    // Called from the grab thread, waits until every frame submitted so far was published or dropped.
+    void drain();
+
+    uint64_t convertQueueDropCount() const { return m_convertQueue.droppedCount(); }
+    uint64_t publishQueueDropCount() const { return m_publishQueue.droppedCount(); }
+    size_t convertQueueSize() const { return m_convertQueue.size(); }
+    size_t publishQueueSize() const { return m_publishQueue.size(); }
+
+private:
+    void convertLoop();
+    void publishLoop();
+    bool drained() const;
+    void stageAdvanced();
+
+    ConvertFunction m_convert;
+    PublishFunction m_publish;
+    SpscRing<RawFrame> m_convertQueue;
+    SpscRing<ConvertedFrame> m_publishQueue;
+    std::thread m_convertThread;
+    std::thread m_publishThread;
+    std::atomic<bool> m_running;
+
+    // Frames through each stage, for drain(). Dropped frames are counted by the rings.
+    uint64_t m_submitted = 0;
+    std::atomic<uint64_t> m_converted;
+    std::atomic<uint64_t> m_handedOver;
+    std::atomic<uint64_t> m_published;
+    // Set while drain() waits, the stages only notify then.
+    std::atomic<bool> m_draining;
+    std::mutex m_drainMutex;
+    std::condition_variable m_stageAdvanced;
+};
+
+#endif
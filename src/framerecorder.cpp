@@ -0,0 +1,182 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "framerecorder.h"
+#include "unpack.h"
+
+namespace
+{
+
+uint64_t alignUp(uint64_t value)
+{
+    return (value + RECORDING_ALIGNMENT - 1) / RECORDING_ALIGNMENT * RECORDING_ALIGNMENT;
+}
+
+} // namespace
+
+RecordingMode recordingModeFromString(const std::string& mode)
+{
+    if(mode.compare("Linear") == 0)
+    {
+        return RecordingMode::Linear;
+    }
+    else if(mode.compare("Ring") == 0)
+    {
+        return RecordingMode::Ring;
+    }
+    throw std::invalid_argument("Unknown recording mode: " + mode);
+}
+
+FrameRecorder::FrameRecorder(const RecordingSettings& settings, SourcePixelFormat pixelFormat,
+                             BayerPattern bayerPattern, uint32_t bitDepth) :
+                             m_settings(settings),
+                             m_pixelFormat(pixelFormat),
+                             m_bayerPattern(bayerPattern),
+                             m_bitDepth(bitDepth),
+                             m_queue(RECORDING_QUEUE_DEPTH, OverflowPolicy::DropNewest)
+{
+    if(m_settings.frames == 0)
+    {
+        throw std::invalid_argument("A recording needs room for at least one frame.");
+    }
+    m_writer = std::thread(&FrameRecorder::writerLoop, this);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    m_queue.close();
+    m_writer.join();
+
+    std::cout << "Recorded " << m_framesWritten << " frames to " << m_settings.file;
+    if(m_queue.droppedCount() > 0 || m_framesRejected > 0)
+    {
+        std::cout << ", " << m_queue.droppedCount() << " frames dropped because the disk fell behind, "
+                  << m_framesRejected << " could not be written";
+    }
+    std::cout << "." << std::endl;
+}
+
+void FrameRecorder::submit(const RawFrame& frame)
+{
+    // Shares the grab result, which keeps the buffer from being queued again until it is written.
+    RawFrame reference = frame;
+    reference.bufferFactory = nullptr;
+
+    if(!m_queue.push(std::move(reference)) && !m_dropReported)
+    {
+        std::cerr << "Recording cannot keep up, frames are being dropped.\n\n" << "Further warnings will be supressed." << std::endl;
+        m_dropReported = true;
+    }
+}
+
+void FrameRecorder::writerLoop()
+{
+    RawFrame frame;
+
+    for(;;)
+    {
+        if(!m_queue.pop(frame, std::chrono::milliseconds(PIPELINE_POP_TIMEOUT_MS)))
+        {
+            if(m_queue.isClosed())
+            {
+                break;
+            }
+            continue;
+        }
+
+        try
+        {
+            write(frame);
+        }
+        catch(const std::exception& e)
+        {
+            // Most likely the file could not be created, which will not get better.
+            std::cerr << "Recording failed: " << e.what() << std::endl;
+            m_failed = true;
+            m_framesRejected++;
+        }
+        frame = RawFrame();
+    }
+}
+
+void FrameRecorder::createFile(uint64_t frameSize)
+{
+    uint64_t slotCount = m_settings.frames;
+    uint64_t slotSize = alignUp(frameSize);
+    uint64_t indexOffset = alignUp(sizeof(RecordingHeader));
+    uint64_t dataOffset = alignUp(indexOffset + slotCount * sizeof(RecordingIndexEntry));
+
+    m_file.create(m_settings.file, dataOffset + slotCount * slotSize);
+
+    m_header = (RecordingHeader*) m_file.data();
+    std::memcpy(m_header->magic, recordingMagic, sizeof(recordingMagic));
+    m_header->version = RECORDING_VERSION;
+    m_header->pixelFormat = (uint32_t) m_pixelFormat;
+    m_header->bayerPattern = (uint32_t) m_bayerPattern;
+    m_header->bitDepth = m_bitDepth;
+    m_header->ring = m_settings.mode == RecordingMode::Ring ? 1 : 0;
+    m_header->slotCount = slotCount;
+    m_header->slotSize = slotSize;
+    m_header->indexOffset = indexOffset;
+    m_header->dataOffset = dataOffset;
+    m_header->framesWritten = 0;
+
+    m_index = (RecordingIndexEntry*) (m_file.data() + indexOffset);
+    std::cout << "Recording up to " << slotCount << " frames to " << m_settings.file << " ("
+              << (dataOffset + slotCount * slotSize) / (1024 * 1024) << " MiB)." << std::endl;
+}
+
+void FrameRecorder::write(const RawFrame& frame)
+{
+    uint64_t numberOfPixels = (uint64_t) frame.width * frame.height;
+    uint64_t frameSize = isPacked(m_pixelFormat) ? Unpacker::packedSize(numberOfPixels) : numberOfPixels;
+
+    if(m_failed || frameSize == 0)
+    {
+        m_framesRejected++;
+        return;
+    }
+    if(!m_file.isOpen())
+    {
+        createFile(frameSize);
+    }
+
+    if(frameSize > m_header->slotSize)
+    {
+        m_framesRejected++;
+        return;
+    }
+    if(m_settings.mode == RecordingMode::Linear && m_framesWritten >= m_header->slotCount)
+    {
+        if(!m_fullReported)
+        {
+            std::cout << "Recording " << m_settings.file << " is full." << std::endl;
+            m_fullReported = true;
+        }
+        return;
+    }
+
+    uint64_t slot = m_framesWritten % m_header->slotCount;
+    uint64_t offset = m_header->dataOffset + slot * m_header->slotSize;
+    std::memcpy(m_file.data() + offset, frame.buffer, frameSize);
+
+    RecordingIndexEntry& entry = m_index[slot];
+    entry.grabId = frame.info.grabId;
+    entry.cameraTimestamp = frame.info.cameraTimestamp;
+    entry.retrieveTime = frame.info.retrieveTime;
+    entry.offset = offset;
+    entry.size = frameSize;
+    entry.width = frame.width;
+    entry.height = frame.height;
+
+    m_framesWritten++;
+    m_header->framesWritten = m_framesWritten;
+}
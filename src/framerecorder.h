@@ -0,0 +1,87 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMERECORDER_HPP
+#define FRAMERECORDER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "demosaic.h"
+#include "framepipeline.h"
+#include "framesource.h"
+#include "recordingfile.h"
+#include "spscring.h"
+
+#define DEFAULT_RECORDING_FRAMES 1000
+// Every frame waiting to be written holds one of the buffers of the grab engine.
+#define RECORDING_QUEUE_DEPTH 8
+
+enum class RecordingMode
+{
+    Linear,     // Stops recording when the file is full.
+    Ring        // Keeps overwriting the oldest frame, so the file holds the frames before the node stopped.
+};
+
+RecordingMode recordingModeFromString(const std::string& mode);
+
+struct RecordingSettings
+{
+    // Empty turns recording off.
+    std::string file;
+    uint64_t frames = DEFAULT_RECORDING_FRAMES;
+    RecordingMode mode = RecordingMode::Linear;
+};
+
+/*
+    Writes raw grab buffers, exactly as they came from the source, into a preallocated and
+    memory mapped recording. The grab thread only queues a reference to the grab result; a
+    writer thread copies the pixels into the frame's slot and fills in its index entry. The
+    file is created when the first frame arrives, with slots the page rounded size of that
+    frame. If the writer falls behind, new frames are dropped rather than holding up the grab.
+*/
+class FrameRecorder
+{
+public:
+    FrameRecorder(const RecordingSettings& settings, SourcePixelFormat pixelFormat,
+                  BayerPattern bayerPattern, uint32_t bitDepth);
+    // Writes what is still queued, then closes the file.
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // From the grab thread. The frame itself stays with the caller.
+    void submit(const RawFrame& frame);
+
+private:
+    void writerLoop();
+    void write(const RawFrame& frame);
+    void createFile(uint64_t frameSize);
+
+    RecordingSettings m_settings;
+    SourcePixelFormat m_pixelFormat;
+    BayerPattern m_bayerPattern;
+    uint32_t m_bitDepth;
+
+    SpscRing<RawFrame> m_queue;
+    std::thread m_writer;
+    bool m_dropReported = false;
+
+    // Only touched by the writer thread.
+    MappedFile m_file;
+    RecordingHeader* m_header = nullptr;
+    RecordingIndexEntry* m_index = nullptr;
+    uint64_t m_framesWritten = 0;
+    uint64_t m_framesRejected = 0;
+    bool m_failed = false;
+    bool m_fullReported = false;
+};
+
+#endif
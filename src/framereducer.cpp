@@ -0,0 +1,185 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include "framereducer.h"
+
+uint32_t remainingFactor(uint32_t requested, uint32_t done)
+{
+    return (done > 0 && requested % done == 0) ? requested / done : requested;
+}
+
+SoftwareReduction softwareReductionFor(const RoiSettings& roi, uint32_t roiWidth, uint32_t roiHeight,
+                                       const SensorReduction& sensor)
+{
+    SoftwareReduction reduction;
+
+    if(!sensor.offsetApplied)
+    {
+        // The sensor delivers the full frame, reduced by whatever it did apply.
+        uint32_t sensorFactorX = sensor.binningX * sensor.decimationX;
+        uint32_t sensorFactorY = sensor.binningY * sensor.decimationY;
+        reduction.cropX = (uint32_t) std::max<int64_t>(roi.offsetX, 0) / sensorFactorX;
+        reduction.cropY = (uint32_t) std::max<int64_t>(roi.offsetY, 0) / sensorFactorY;
+        reduction.cropWidth = roiWidth / sensorFactorX;
+        reduction.cropHeight = roiHeight / sensorFactorY;
+    }
+
+    reduction.binningX = remainingFactor(roi.binning, sensor.binningX);
+    reduction.binningY = remainingFactor(roi.binning, sensor.binningY);
+    reduction.decimationX = remainingFactor(roi.decimation, sensor.decimationX);
+    reduction.decimationY = remainingFactor(roi.decimation, sensor.decimationY);
+    return reduction;
+}
+
+FrameReducer::FrameReducer(const SoftwareReduction& reduction, bool bayer) :
+                           m_reduction(reduction),
+                           m_bayer(bayer)
+{
+    m_reduction.binningX = std::max<uint32_t>(m_reduction.binningX, 1);
+    m_reduction.binningY = std::max<uint32_t>(m_reduction.binningY, 1);
+    m_reduction.decimationX = std::max<uint32_t>(m_reduction.decimationX, 1);
+    m_reduction.decimationY = std::max<uint32_t>(m_reduction.decimationY, 1);
+
+    m_active = m_reduction.cropWidth > 0 || m_reduction.cropHeight > 0 ||
+               m_reduction.binningX > 1 || m_reduction.binningY > 1 ||
+               m_reduction.decimationX > 1 || m_reduction.decimationY > 1;
+}
+
+void FrameReducer::cropOf(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y, uint32_t& cropWidth, uint32_t& cropHeight) const
+{
+    x = std::min(m_reduction.cropX, width);
+    y = std::min(m_reduction.cropY, height);
+    cropWidth = m_reduction.cropWidth > 0 ? std::min(m_reduction.cropWidth, width - x) : width - x;
+    cropHeight = m_reduction.cropHeight > 0 ? std::min(m_reduction.cropHeight, height - y) : height - y;
+
+    if(m_bayer)
+    {
+        // Even offsets keep the Bayer phase the camera reported.
+        x &= ~1u;
+        y &= ~1u;
+        cropWidth &= ~1u;
+        cropHeight &= ~1u;
+    }
+}
+
+void FrameReducer::outputSize(uint32_t width, uint32_t height, uint32_t& outputWidth, uint32_t& outputHeight) const
+{
+    uint32_t x, y, cropWidth, cropHeight;
+    cropOf(width, height, x, y, cropWidth, cropHeight);
+
+    uint32_t factorX = m_reduction.binningX * m_reduction.decimationX;
+    uint32_t factorY = m_reduction.binningY * m_reduction.decimationY;
+
+    if(m_bayer)
+    {
+        outputWidth = cropWidth / 2 / factorX * 2;
+        outputHeight = cropHeight / 2 / factorY * 2;
+    }
+    else
+    {
+        outputWidth = cropWidth / factorX;
+        outputHeight = cropHeight / factorY;
+    }
+}
+
+/*
+    Output position i takes the binning samples number i * binning + k (k < binning) of the
+    decimated frame, which sit at (i * binning + k) * decimation in the cropped frame. For Bayer
+    frames the same is done on 2x2 cells and the position inside the cell is kept.
+*/
+void buildPositions(std::vector<uint32_t>& positions, uint32_t outputSize, uint32_t offset,
+                    uint32_t binning, uint32_t decimation, bool bayer)
+{
+    positions.resize((size_t) outputSize * binning);
+
+    for(uint32_t i = 0; i < outputSize; i++)
+    {
+        for(uint32_t k = 0; k < binning; k++)
+        {
+            uint32_t position;
+            if(bayer)
+            {
+                position = ((i / 2) * binning + k) * decimation * 2 + i % 2;
+            }
+            else
+            {
+                position = (i * binning + k) * decimation;
+            }
+            positions[(size_t) i * binning + k] = offset + position;
+        }
+    }
+}
+
+void FrameReducer::buildTables(uint32_t width, uint32_t height)
+{
+    uint32_t x, y, cropWidth, cropHeight, outputWidth, outputHeight;
+    cropOf(width, height, x, y, cropWidth, cropHeight);
+    outputSize(width, height, outputWidth, outputHeight);
+
+    buildPositions(m_columns, outputWidth, x, m_reduction.binningX, m_reduction.decimationX, m_bayer);
+    buildPositions(m_rows, outputHeight, y, m_reduction.binningY, m_reduction.decimationY, m_bayer);
+    m_tableWidth = width;
+    m_tableHeight = height;
+}
+
+void FrameReducer::process(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                           uint8_t* destination, WorkerPool& pool)
+{
+    if(width != m_tableWidth || height != m_tableHeight)
+    {
+        buildTables(width, height);
+    }
+
+    uint32_t outputWidth, outputHeight;
+    outputSize(width, height, outputWidth, outputHeight);
+
+    const uint32_t binningX = m_reduction.binningX;
+    const uint32_t binningY = m_reduction.binningY;
+    const uint32_t samples = binningX * binningY;
+    const uint32_t* columns = m_columns.data();
+    const uint32_t* rows = m_rows.data();
+
+    size_t numberOfBands = pool.numberOfThreads();
+    uint32_t rowsPerBand = (uint32_t) ((outputHeight + numberOfBands - 1) / numberOfBands);
+
+    pool.parallelFor(numberOfBands, [&](size_t band)
+    {
+        uint32_t firstRow = (uint32_t) band * rowsPerBand;
+        uint32_t lastRow = std::min(outputHeight, firstRow + rowsPerBand);
+
+        for(uint32_t y = firstRow; y < lastRow; y++)
+        {
+            uint8_t* output = destination + (size_t) y * outputWidth;
+
+            if(samples == 1)
+            {
+                const uint8_t* input = source + (size_t) rows[y] * sourceStride;
+                for(uint32_t x = 0; x < outputWidth; x++)
+                {
+                    output[x] = input[columns[x]];
+                }
+                continue;
+            }
+
+            for(uint32_t x = 0; x < outputWidth; x++)
+            {
+                uint32_t sum = samples / 2;
+                for(uint32_t ky = 0; ky < binningY; ky++)
+                {
+                    const uint8_t* input = source + (size_t) rows[(size_t) y * binningY + ky] * sourceStride;
+                    for(uint32_t kx = 0; kx < binningX; kx++)
+                    {
+                        sum += input[columns[(size_t) x * binningX + kx]];
+                    }
+                }
+                output[x] = (uint8_t) (sum / samples);
+            }
+        }
+    });
+}
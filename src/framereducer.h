@@ -0,0 +1,87 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMEREDUCER_HPP
+#define FRAMEREDUCER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "workerpool.h"
+
+// Region and resolution the user asked for. ImageWidth x ImageHeight is the size of the region.
+struct RoiSettings
+{
+    // In sensor pixels.
+    int64_t offsetX = 0;
+    int64_t offsetY = 0;
+    // Factors by which both directions are reduced. Binning averages, decimation skips.
+    uint32_t binning = 1;
+    uint32_t decimation = 1;
+};
+
+// What the frame source already did before the frames reached the host.
+struct SensorReduction
+{
+    bool offsetApplied = true;
+    uint32_t binningX = 1, binningY = 1;
+    uint32_t decimationX = 1, decimationY = 1;
+};
+
+// What is left to do on the host.
+struct SoftwareReduction
+{
+    // A crop width or height of 0 keeps the full frame.
+    uint32_t cropX = 0, cropY = 0, cropWidth = 0, cropHeight = 0;
+    uint32_t binningX = 1, binningY = 1;
+    uint32_t decimationX = 1, decimationY = 1;
+};
+
+SoftwareReduction softwareReductionFor(const RoiSettings& roi, uint32_t roiWidth, uint32_t roiHeight,
+                                       const SensorReduction& sensor);
+
+/*
+    Crops, decimates and bins raw 8 bit frames on the host, for cameras that cannot do it on the
+    sensor. Bayer frames stay Bayer frames: binning averages pixels of the same color and
+    decimation keeps whole 2x2 cells, so the demosaic afterwards only sees the reduced number
+    of pixels. Source positions are looked up in per column and per row tables that are only
+    rebuilt when the input size changes.
+*/
+class FrameReducer
+{
+public:
+    FrameReducer(const SoftwareReduction& reduction, bool bayer);
+
+    // False if frames pass through unchanged.
+    bool active() const { return m_active; }
+
+    void outputSize(uint32_t width, uint32_t height, uint32_t& outputWidth, uint32_t& outputHeight) const;
+
+    // The output has outputSize() pixels and is written with a stride of its width.
+    void process(const uint8_t* source, size_t sourceStride, uint32_t width, uint32_t height,
+                 uint8_t* destination, WorkerPool& pool);
+
+    // Room for a reduced frame that still has to be demosaiced, reused from frame to frame.
+    std::vector<uint8_t>& scratch() { return m_scratch; }
+
+private:
+    void buildTables(uint32_t width, uint32_t height);
+    void cropOf(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y, uint32_t& cropWidth, uint32_t& cropHeight) const;
+
+    SoftwareReduction m_reduction;
+    bool m_bayer;
+    bool m_active;
+
+    uint32_t m_tableWidth = 0, m_tableHeight = 0;
+    // binning source columns per output column, binning source rows per output row.
+    std::vector<uint32_t> m_columns;
+    std::vector<uint32_t> m_rows;
+    std::vector<uint8_t> m_scratch;
+};
+
+#endif
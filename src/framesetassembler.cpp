@@ -0,0 +1,142 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <iostream>
+#include "framesetassembler.h"
+
+FrameSetAssembler::FrameSetAssembler(const std::vector<std::string>& serialNumbers,
+                                     uint64_t toleranceNs,
+                                     bool useCameraTimestamps,
+                                     PublishFunction publish) :
+                                     m_serialNumbers(serialNumbers),
+                                     m_toleranceNs(toleranceNs),
+                                     m_useCameraTimestamps(useCameraTimestamps),
+                                     m_publish(publish),
+                                     m_pending(serialNumbers.size())
+{
+}
+
+void FrameSetAssembler::add(size_t cameraIndex, ConvertedFrame&& frame)
+{
+    std::vector<ConvertedFrame> frameSet;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::deque<ConvertedFrame>& pending = m_pending[cameraIndex];
+        if(pending.size() >= FRAME_SET_REORDER_DEPTH)
+        {
+            // The other cameras are too far behind, this frame will never be matched.
+            pending.pop_front();
+            m_droppedCount++;
+        }
+        pending.push_back(std::move(frame));
+
+        if(!takeMatchingSet(frameSet))
+        {
+            return;
+        }
+        m_publishedCount++;
+    }
+
+    // Serialize outside the lock so that the other cameras can keep adding frames.
+    link_dev::basler::FrameSetT message;
+    message.timestamp = (uint64_t) timestampOf(frameSet[0]);
+    // All cameras run with the same settings, so either all frames have chunks or none.
+    bool hasChunks = frameSet[0].info.hasChunks;
+    for(size_t i = 0; i < frameSet.size(); i++)
+    {
+        message.serial_numbers.push_back(m_serialNumbers[i]);
+        message.camera_timestamps.push_back(frameSet[i].info.cameraTimestamp);
+        message.images.push_back(std::unique_ptr<link_dev::ImageT>(new link_dev::ImageT(std::move(frameSet[i].image))));
+        if(hasChunks)
+        {
+            message.metadata.push_back(frameMetadataOf(frameSet[i].info));
+        }
+    }
+
+    try
+    {
+        m_publish(message);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << "Publishing a frame set failed: " << e.what() << std::endl;
+    }
+
+    // Grab buffers lent to the images have to go back through their frames.
+    for(size_t i = 0; i < frameSet.size(); i++)
+    {
+        frameSet[i].image = std::move(*message.images[i]);
+    }
+}
+
+void FrameSetAssembler::discardPending(size_t cameraIndex)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending[cameraIndex].clear();
+}
+
+uint64_t FrameSetAssembler::publishedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_publishedCount;
+}
+
+uint64_t FrameSetAssembler::droppedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_droppedCount;
+}
+
+int64_t FrameSetAssembler::timestampOf(const ConvertedFrame& frame) const
+{
+    return m_useCameraTimestamps ? (int64_t) frame.info.cameraTimestamp : frame.info.retrieveTime;
+}
+
+/*
+    Looks at the oldest pending frame of every camera. The newest of those sets the instant to
+    match, everything older than that minus the tolerance has lost its partners and is dropped.
+    Repeats until either some camera has nothing pending or all oldest frames fit the window.
+*/
+bool FrameSetAssembler::takeMatchingSet(std::vector<ConvertedFrame>& frameSet)
+{
+    for(;;)
+    {
+        int64_t newest = 0;
+        for(const std::deque<ConvertedFrame>& pending : m_pending)
+        {
+            if(pending.empty())
+            {
+                return false;
+            }
+            newest = std::max(newest, timestampOf(pending.front()));
+        }
+
+        bool allWithinTolerance = true;
+        for(std::deque<ConvertedFrame>& pending : m_pending)
+        {
+            if(newest - timestampOf(pending.front()) > (int64_t) m_toleranceNs)
+            {
+                pending.pop_front();
+                m_droppedCount++;
+                allWithinTolerance = false;
+            }
+        }
+
+        if(allWithinTolerance)
+        {
+            for(std::deque<ConvertedFrame>& pending : m_pending)
+            {
+                frameSet.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+            return true;
+        }
+    }
+}
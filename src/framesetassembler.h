@@ -0,0 +1,64 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMESETASSEMBLER_HPP
+#define FRAMESETASSEMBLER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "framepipeline.h"
+#include "FrameSet_generated.h"
+
+#define DEFAULT_FRAME_SET_TOLERANCE_US 1000
+#define FRAME_SET_REORDER_DEPTH 4
+
+/*
+    Groups the frames of several cameras by capture instant. Every camera feeds its frames in
+    through add(), from its own thread. As soon as every camera has a frame within the tolerance
+    window of the others, the set is handed to the publish function as one FrameSet.
+    Frames that can no longer be matched (their partners were lost or are too far apart) are dropped.
+*/
+class FrameSetAssembler
+{
+public:
+    using PublishFunction = std::function<void(link_dev::basler::FrameSetT&)>;
+
+    // With useCameraTimestamps the camera clocks must be synchronized (PTP), otherwise frames
+    // are matched by the host time at which they were retrieved.
+    FrameSetAssembler(const std::vector<std::string>& serialNumbers,
+                      uint64_t toleranceNs,
+                      bool useCameraTimestamps,
+                      PublishFunction publish);
+
+    void add(size_t cameraIndex, ConvertedFrame&& frame);
+    // Drops the frames of a camera that stops, they cannot outlive its buffers.
+    void discardPending(size_t cameraIndex);
+
+    uint64_t publishedCount() const;
+    uint64_t droppedCount() const;
+
+private:
+    int64_t timestampOf(const ConvertedFrame& frame) const;
+    bool takeMatchingSet(std::vector<ConvertedFrame>& frameSet);
+
+    std::vector<std::string> m_serialNumbers;
+    uint64_t m_toleranceNs;
+    bool m_useCameraTimestamps;
+    PublishFunction m_publish;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::deque<ConvertedFrame>> m_pending;
+    uint64_t m_publishedCount = 0;
+    uint64_t m_droppedCount = 0;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <iostream>
+#include "framerecorder.h"
+#include "framesource.h"
+
+namespace
+{
+
+void applyControl(FrameSource& source, FramePipeline& pipeline, CameraTelemetry& telemetry, GrabControl& control)
+{
+    std::vector<ControlParameter> parameters;
+    if(!control.mailbox->take(parameters))
+    {
+        return;
+    }
+
+    ControlResult result = ControlResult::Applied;
+    try
+    {
+        result = source.applyControl(parameters);
+    }
+    catch(const std::exception& e)
+    {
+        // The source went back to its previous settings, possibly through a restart that
+        // started the grab IDs over.
+        std::cerr << "Could not apply all control parameters: " << e.what() << std::endl;
+        telemetry.recordRestart();
+        return;
+    }
+
+    if(result == ControlResult::Unsupported)
+    {
+        std::cerr << "The frame source cannot be changed while grabbing." << std::endl;
+    }
+    else if(result == ControlResult::Restarted)
+    {
+        telemetry.recordRestart();
+        // The frames of the old size are converted the old way before the conversion changes.
+        pipeline.drain();
+        if(control.frameSizeChanged)
+        {
+            control.frameSizeChanged(parameters);
+        }
+    }
+}
+
+} // namespace
+
+void runGrabLoop(FrameSource& source,
+                 const PipelineSettings& pipelineSettings,
+                 FramePipeline::ConvertFunction convert,
+                 FramePipeline::PublishFunction publish,
+                 CameraTelemetry& telemetry,
+                 FrameRecorder* recorder,
+                 GrabControl* control)
+{
+    FramePipeline pipeline(pipelineSettings, convert, publish);
+    if(pipelineSettings.enabled)
+    {
+        pipeline.start();
+    }
+
+    bool frameDropErrorOccurredOnce = false;
+    bool pipelineDropOccurredOnce = false;
+
+    for(;;)
+    {
+        if(control != nullptr && control->mailbox->pending())
+        {
+            applyControl(source, pipeline, telemetry, *control);
+        }
+
+        RawFrame rawFrame;
+        GrabError error;
+        GrabStatus status = source.grab(rawFrame, error);
+
+        if(status == GrabStatus::Terminated)
+        {
+            break;
+        }
+        if(status == GrabStatus::Timeout)
+        {
+            continue;
+        }
+        if(status == GrabStatus::Disconnected)
+        {
+            telemetry.recordDisconnect();
+            if(!source.reconnect())
+            {
+                break;
+            }
+            telemetry.recordReconnect();
+            continue;
+        }
+
+        telemetry.recordGrabResult(rawFrame.info.grabId, rawFrame.info.skippedImages);
+
+        if(telemetry.gaugesRequested())
+        {
+            uint32_t readyBuffers, queuedBuffers;
+            source.bufferCounts(readyBuffers, queuedBuffers);
+            telemetry.setGauges(readyBuffers,
+                                queuedBuffers,
+                                (uint32_t) pipeline.convertQueueSize(),
+                                (uint32_t) pipeline.publishQueueSize(),
+                                pipeline.convertQueueDropCount(),
+                                pipeline.publishQueueDropCount());
+
+            TransportStatistics transportStatistics;
+            source.transportStatistics(transportStatistics);
+            telemetry.setTransportStatistics(transportStatistics);
+        }
+
+        if(status == GrabStatus::Failed)
+        {
+            telemetry.recordGrabError(error.code);
+            if(!frameDropErrorOccurredOnce)
+            {
+                std::cerr << "Error: " << error.code << " " << error.description << "\n\n" << "Further warnings will be supressed." << std::endl;
+                frameDropErrorOccurredOnce = true;
+            }
+            continue;
+        }
+
+        if(recorder != nullptr)
+        {
+            recorder->submit(rawFrame);
+        }
+
+        if(pipelineSettings.enabled)
+        {
+            if(!pipeline.submit(std::move(rawFrame)) && !pipelineDropOccurredOnce)
+            {
+                std::cerr << "Pipeline queue overflow, frames are being dropped.\n\n" << "Further warnings will be supressed." << std::endl;
+                pipelineDropOccurredOnce = true;
+            }
+        }
+        else
+        {
+            // Like the pipeline stages, a frame that fails is lost but the camera keeps grabbing.
+            ConvertedFrame convertedFrame;
+            convertedFrame.info = rawFrame.info;
+            bool converted = false;
+            try
+            {
+                converted = convert(rawFrame, convertedFrame);
+            }
+            catch(const std::exception& e)
+            {
+                std::cerr << "Frame conversion failed: " << e.what() << std::endl;
+            }
+            if(converted)
+            {
+                try
+                {
+                    publish(convertedFrame);
+                }
+                catch(const std::exception& e)
+                {
+                    std::cerr << "Publishing a frame failed: " << e.what() << std::endl;
+                }
+            }
+            convertedFrame.returnBuffer();
+        }
+    }
+
+    pipeline.stop();
+}
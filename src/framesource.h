@@ -0,0 +1,146 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef FRAMESOURCE_HPP
+#define FRAMESOURCE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cameracontrol.h"
+#include "demosaic.h"
+#include "framepipeline.h"
+#include "framereducer.h"
+#include "telemetry.h"
+
+class FrameRecorder;
+
+enum class GrabStatus
+{
+    Succeeded,
+    Failed,
+    Timeout,
+    Terminated,
+    Disconnected    // The camera is gone, reconnect() may bring it back.
+};
+
+// What FrameSource::applyControl() did.
+enum class ControlResult
+{
+    Applied,        // In effect from one of the next frames on.
+    Restarted,      // The frames change size, grabbing was stopped and started again.
+    Unsupported     // The source cannot be changed while it grabs.
+};
+
+struct GrabError
+{
+    uint32_t code = 0;
+    std::string description;
+};
+
+// What a source can be asked to deliver. The packed formats hold two pixels in three bytes.
+enum class SourcePixelFormat
+{
+    Mono8,
+    Bayer8,
+    MonoPacked,
+    BayerPacked
+};
+
+inline bool isBayer(SourcePixelFormat format)
+{
+    return format == SourcePixelFormat::Bayer8 || format == SourcePixelFormat::BayerPacked;
+}
+
+inline bool isPacked(SourcePixelFormat format)
+{
+    return format == SourcePixelFormat::MonoPacked || format == SourcePixelFormat::BayerPacked;
+}
+
+/*
+    Where raw frames come from: a camera (PylonFrameSource) or something that only pretends to
+    be one (SyntheticFrameSource). Everything after grab() is the same for all sources.
+*/
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    virtual void start(SourcePixelFormat format) = 0;
+    virtual void stop() = 0;
+
+    /*
+        Waits for the next frame. On Succeeded the frame is filled in and keeps its buffer
+        valid for as long as it is held. On Failed frame.info still identifies the grab.
+        Terminated means the source will not deliver any more frames.
+    */
+    virtual GrabStatus grab(RawFrame& frame, GrabError& error) = 0;
+
+    // Phase of the Bayer frames and bits per pixel, valid after start().
+    virtual BayerPattern bayerPattern() const = 0;
+    virtual uint32_t bitDepth() const = 0;
+
+    // How much of the region of interest, binning and decimation the source already took care of.
+    virtual SensorReduction sensorReduction() const { return SensorReduction(); }
+
+    // Buffers of the grab engine, valid after start(). 0 if the source has no grab engine.
+    virtual size_t grabBuffers() const { return 0; }
+
+    /*
+        After grab() returned Disconnected, tries until the source delivers frames again.
+        Returns false if it gave up or was asked to terminate.
+    */
+    virtual bool reconnect() { return false; }
+
+    /*
+        Applies control parameters between two frames. Throws std::invalid_argument for a
+        parameter that does not exist or cannot be changed while grabbing, and
+        std::runtime_error if the source did not take them. Either way the source keeps
+        grabbing with its previous settings, or reports Disconnected from the next grab().
+    */
+    virtual ControlResult applyControl(const std::vector<ControlParameter>& parameters) { return ControlResult::Unsupported; }
+
+    // Packet loss and resends on the way from the camera, if the source has a network in between.
+    virtual void transportStatistics(TransportStatistics& statistics) {}
+
+    // Buffers waiting to be grabbed and buffers waiting to be filled, if the source has any.
+    virtual void bufferCounts(uint32_t& readyBuffers, uint32_t& queuedBuffers)
+    {
+        readyBuffers = 0;
+        queuedBuffers = 0;
+    }
+};
+
+/*
+    Where runGrabLoop picks up control parameters. After the source restarted with frames of
+    another size, frameSizeChanged is called on the grab thread once every frame grabbed before
+    was published, so that the conversion can be adapted to the new frames.
+*/
+struct GrabControl
+{
+    ControlMailbox* mailbox = nullptr;
+    std::function<void(const std::vector<ControlParameter>&)> frameSizeChanged;
+};
+
+/*
+    Grabs from the source until it terminates. Every frame is converted and published, either
+    inline or through a FramePipeline, and accounted for in the telemetry. If a recorder is
+    given, it gets every grabbed frame as it came from the source. A source that lost its
+    camera is reconnected, frames still in the pipeline are published meanwhile. Control
+    parameters are applied to the source between two frames.
+*/
+void runGrabLoop(FrameSource& source,
+                 const PipelineSettings& pipelineSettings,
+                 FramePipeline::ConvertFunction convert,
+                 FramePipeline::PublishFunction publish,
+                 CameraTelemetry& telemetry,
+                 FrameRecorder* recorder = nullptr,
+                 GrabControl* control = nullptr);
+
+#endif
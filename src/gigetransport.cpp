@@ -0,0 +1,153 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "gigetransport.h"
+
+namespace
+{
+
+int64_t clampToRange(Pylon::CIntegerParameter& parameter, int64_t value)
+{
+    return std::max(parameter.GetMin(), std::min(parameter.GetMax(), value));
+}
+
+uint64_t readStatistic(GenApi::INodeMap& nodemap, const char* name)
+{
+    Pylon::CIntegerParameter statistic(nodemap, name);
+    return statistic.IsReadable() ? (uint64_t) statistic.GetValue() : 0;
+}
+
+} // namespace
+
+int64_t setPacketSize(GenApi::INodeMap& nodemap, int64_t mtu)
+{
+    Pylon::CIntegerParameter packetSize(nodemap, "GevSCPSPacketSize");
+    // The Nearest correction would round 9014 up past the MTU, e.g. to 9016 with an increment of 4.
+    int64_t inc = std::max<int64_t>(packetSize.GetInc(), 1);
+    int64_t value = clampToRange(packetSize, mtu);
+    value = packetSize.GetMin() + (value - packetSize.GetMin()) / inc * inc;
+    packetSize.SetValue(value);
+    return value;
+}
+
+size_t prepareTransport(Pylon::CBaslerGigEInstantCamera& camera, const TransportSettings& settings,
+                        double frameRate, size_t heldBuffers, size_t minimumBuffers)
+{
+    GenApi::INodeMap& nodemap = camera.GetNodeMap();
+    GenApi::INodeMap& streamNodemap = camera.GetStreamGrabberNodeMap();
+
+    // The stream grabber tries out the largest packet size the path to the camera takes, up to
+    // the packet size that was set from NetworkInterfaceMTU.
+    if(Pylon::CBooleanParameter(streamNodemap, "AutoPacketSize").TrySetValue(true))
+    {
+        std::cout << "Packet size is probed when grabbing starts." << std::endl;
+    }
+
+    int64_t payloadSize = Pylon::CIntegerParameter(nodemap, "PayloadSize").GetValue();
+    size_t buffers = (size_t) std::ceil(frameRate * GRAB_BUFFER_SECONDS) + heldBuffers;
+    buffers = std::max(buffers, (size_t) MIN_GRAB_BUFFERS);
+    buffers = std::min(buffers, std::max((size_t) (MAX_GRAB_BUFFER_BYTES / std::max<int64_t>(payloadSize, 1)), (size_t) MIN_GRAB_BUFFERS));
+    // A GrabBufferCount above that was asked for explicitly and is kept, also past the memory cap.
+    buffers = std::max(buffers, minimumBuffers);
+    camera.MaxNumBuffer.SetValue(buffers);
+
+    // Only the socket driver has a socket buffer, in KiB.
+    Pylon::CIntegerParameter socketBufferSize(streamNodemap, "SocketBufferSize");
+    int64_t socketBufferKiB = 0;
+    if(socketBufferSize.IsWritable())
+    {
+        socketBufferKiB = clampToRange(socketBufferSize, payloadSize * SOCKET_BUFFER_FRAMES / 1024);
+        socketBufferKiB = std::max(socketBufferKiB, socketBufferSize.GetValue());
+        socketBufferSize.SetValue(socketBufferKiB, Pylon::IntegerValueCorrection_Nearest);
+    }
+
+    std::cout << "Grab buffers: " << buffers << " of " << payloadSize << " bytes";
+    if(socketBufferKiB > 0)
+    {
+        std::cout << ", socket buffer: " << socketBufferKiB << " KiB";
+    }
+    std::cout << std::endl;
+
+    if(settings.receiveThreadPriority != 0)
+    {
+        if(!Pylon::CBooleanParameter(streamNodemap, "ReceiveThreadPriorityOverride").TrySetValue(true) ||
+           !Pylon::CIntegerParameter(streamNodemap, "ReceiveThreadPriority").TrySetValue(settings.receiveThreadPriority))
+        {
+            std::cerr << "Could not set the receive thread priority to " << settings.receiveThreadPriority << "." << std::endl;
+        }
+    }
+    return buffers;
+}
+
+void balanceBandwidth(Pylon::CBaslerGigEInstantCamera& camera, const TransportSettings& settings,
+                      double frameRate, size_t numberOfCameras)
+{
+    GenApi::INodeMap& nodemap = camera.GetNodeMap();
+    Pylon::CIntegerParameter interPacketDelay(nodemap, "GevSCPD");
+    Pylon::CIntegerParameter bandwidthReserve(nodemap, "GevSCBWR");
+    Pylon::CIntegerParameter tickFrequency(nodemap, "GevTimestampTickFrequency");
+    if(!interPacketDelay.IsWritable() || !tickFrequency.IsReadable())
+    {
+        std::cout << "The camera does not support an inter-packet delay." << std::endl;
+        return;
+    }
+
+    double linkSpeedMbps = settings.linkSpeedMbps;
+    Pylon::CIntegerParameter cameraLinkSpeed(nodemap, "GevLinkSpeed");
+    if(linkSpeedMbps == 0)
+    {
+        linkSpeedMbps = cameraLinkSpeed.IsReadable() ? (double) cameraLinkSpeed.GetValue() : 1000.0;
+    }
+
+    double packetSize = (double) Pylon::CIntegerParameter(nodemap, "GevSCPSPacketSize").GetValue();
+    double payloadSize = (double) Pylon::CIntegerParameter(nodemap, "PayloadSize").GetValue();
+    double bytesOnWire = packetSize + ETHERNET_OVERHEAD_BYTES;
+    // Leader and trailer come on top of the packets that carry the image.
+    double packetsPerFrame = std::ceil(payloadSize / (packetSize - GVSP_HEADER_BYTES)) + 2.0;
+
+    double linkBytesPerSecond = linkSpeedMbps * 1000000.0 / 8.0;
+    double shareBytesPerSecond = linkBytesPerSecond / (double) std::max<size_t>(numberOfCameras, 1);
+    double neededBytesPerSecond = packetsPerFrame * bytesOnWire * frameRate;
+
+    // Sending a packet takes bytesOnWire / linkBytesPerSecond, the pause afterwards stretches
+    // that to what the camera's share of the link allows.
+    double delaySeconds = bytesOnWire / shareBytesPerSecond - bytesOnWire / linkBytesPerSecond;
+    int64_t delayTicks = clampToRange(interPacketDelay, (int64_t) (delaySeconds * (double) tickFrequency.GetValue()));
+    interPacketDelay.SetValue(delayTicks, Pylon::IntegerValueCorrection_Nearest);
+
+    // Whatever the frames leave of the share is kept for resends.
+    int64_t reservePercent = 0;
+    if(bandwidthReserve.IsWritable())
+    {
+        reservePercent = (int64_t) std::floor(std::max(0.0, 1.0 - neededBytesPerSecond / shareBytesPerSecond) * 100.0);
+        reservePercent = clampToRange(bandwidthReserve, reservePercent);
+        bandwidthReserve.SetValue(reservePercent);
+    }
+
+    std::cout << "Packet size: " << (int64_t) packetSize << " bytes, inter-packet delay: " << delayTicks
+              << " ticks, bandwidth reserve: " << reservePercent << "% of " << (int64_t) (shareBytesPerSecond * 8.0 / 1000000.0)
+              << " of " << (int64_t) linkSpeedMbps << " Mbit/s" << std::endl;
+    if(neededBytesPerSecond > shareBytesPerSecond)
+    {
+        std::cerr << "Warning: the camera needs " << (int64_t) (neededBytesPerSecond * 8.0 / 1000000.0)
+                  << " Mbit/s at " << frameRate << " fps, more than its share of the link. Frames will be late or lost." << std::endl;
+    }
+}
+
+void readTransportStatistics(Pylon::CBaslerGigEInstantCamera& camera, TransportStatistics& statistics)
+{
+    GenApi::INodeMap& streamNodemap = camera.GetStreamGrabberNodeMap();
+    statistics.failedBuffers = readStatistic(streamNodemap, "Statistic_Failed_Buffer_Count");
+    statistics.bufferUnderruns = readStatistic(streamNodemap, "Statistic_Buffer_Underrun_Count");
+    statistics.failedPackets = readStatistic(streamNodemap, "Statistic_Failed_Packet_Count");
+    statistics.resendRequests = readStatistic(streamNodemap, "Statistic_Resend_Request_Count");
+    statistics.resentPackets = readStatistic(streamNodemap, "Statistic_Resend_Packet_Count");
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef GIGETRANSPORT_HPP
+#define GIGETRANSPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <pylon/PylonIncludes.h>
+#include <pylon/gige/BaslerGigEInstantCamera.h>
+
+#include "telemetry.h"
+
+// Preamble, Ethernet header, frame check sequence and inter-frame gap of every packet.
+#define ETHERNET_OVERHEAD_BYTES 38
+// IP, UDP and GVSP headers, counted in GevSCPSPacketSize.
+#define GVSP_HEADER_BYTES 36
+// How long the grab engine has to be able to hold frames while nobody retrieves them.
+#define GRAB_BUFFER_SECONDS 0.25
+#define MIN_GRAB_BUFFERS 8
+#define MAX_GRAB_BUFFER_BYTES (1024ull * 1024 * 1024)
+// The socket buffer holds this many frames while the receive thread is not scheduled.
+#define SOCKET_BUFFER_FRAMES 2
+
+struct TransportSettings
+{
+    bool autoTune = false;
+    // 0 takes the link speed the camera reports.
+    uint32_t linkSpeedMbps = 0;
+    // 0 leaves the priority of the stream grabber's receive thread to Pylon.
+    int receiveThreadPriority = 0;
+};
+
+/*
+    Sets GevSCPSPacketSize to the largest value that fits into the MTU, rounded down to the
+    increment the camera needs. Returns the packet size that was set.
+*/
+int64_t setPacketSize(GenApi::INodeMap& nodemap, int64_t mtu);
+
+/*
+    Everything that has to be in place before grabbing starts: packet size probing by the
+    stream grabber, grab buffers for GRAB_BUFFER_SECONDS of frames plus the ones held further
+    down the pipeline, a socket buffer for SOCKET_BUFFER_FRAMES and the receive thread priority.
+    The grab engine never gets fewer than minimumBuffers (GrabBufferCount). Returns the number
+    of grab buffers that was set.
+*/
+size_t prepareTransport(Pylon::CBaslerGigEInstantCamera& camera, const TransportSettings& settings,
+                        double frameRate, size_t heldBuffers, size_t minimumBuffers);
+
+/*
+    Once grabbing runs and the packet size is settled: spaces the packets with GevSCPD so that
+    numberOfCameras cameras sending at once do not exceed the link, and reserves what is left
+    of each camera's share for resends with GevSCBWR.
+*/
+void balanceBandwidth(Pylon::CBaslerGigEInstantCamera& camera, const TransportSettings& settings,
+                      double frameRate, size_t numberOfCameras);
+
+// Stream grabber counters, totals since the camera was opened.
+void readTransportStatistics(Pylon::CBaslerGigEInstantCamera& camera, TransportStatistics& statistics);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include "grabbufferfactory.h"
+
+void GrabBufferFactory::AllocateBuffer(size_t bufferSize, void** pCreatedBuffer, intptr_t& bufferContext)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_freeSlots.empty())
+    {
+        m_freeSlots.push_back((intptr_t) m_slots.size());
+        m_slots.push_back(Slot());
+    }
+    bufferContext = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    Slot& slot = m_slots[bufferContext];
+    slot.storage.reset(new std::vector<uint8_t>(bufferSize));
+    *pCreatedBuffer = slot.storage->data();
+}
+
+void GrabBufferFactory::FreeBuffer(void* pCreatedBuffer, intptr_t bufferContext)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!isAllocated(bufferContext))
+    {
+        return;
+    }
+    Slot& slot = m_slots[bufferContext];
+    if(slot.lent)
+    {
+        // The storage is an image's data right now, giveBack() frees it.
+        slot.freed = true;
+    }
+    else if(slot.storage->data() == pCreatedBuffer)
+    {
+        release(bufferContext);
+    }
+}
+
+void GrabBufferFactory::DestroyBufferFactory()
+{
+    // Lifetime is managed by the owner of the factory.
+}
+
+bool GrabBufferFactory::owns(const Pylon::CGrabResultPtr& grabResult)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    intptr_t bufferContext = grabResult->GetBufferContext();
+    return isAllocated(bufferContext) && m_slots[bufferContext].storage->data() == grabResult->GetBuffer();
+}
+
+bool GrabBufferFactory::lendable(intptr_t bufferContext, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return isAllocated(bufferContext) && !m_slots[bufferContext].lent && m_slots[bufferContext].storage->size() >= size;
+}
+
+void GrabBufferFactory::lend(intptr_t bufferContext, std::vector<uint8_t>& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Slot& slot = m_slots[bufferContext];
+    slot.storage->swap(data);
+    slot.lent = true;
+}
+
+void GrabBufferFactory::giveBack(intptr_t bufferContext, std::vector<uint8_t>& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Slot& slot = m_slots[bufferContext];
+    slot.storage->swap(data);
+    data.clear();
+    slot.lent = false;
+    if(slot.freed)
+    {
+        release(bufferContext);
+    }
+}
+
+bool GrabBufferFactory::isAllocated(intptr_t bufferContext) const
+{
+    return bufferContext >= 0 && (size_t) bufferContext < m_slots.size() && m_slots[bufferContext].storage;
+}
+
+// Keeps the slot, so that the contexts of the remaining buffers stay valid, and reuses it for the next buffer.
+void GrabBufferFactory::release(intptr_t bufferContext)
+{
+    Slot& slot = m_slots[bufferContext];
+    slot.storage.reset();
+    slot.lent = false;
+    slot.freed = false;
+    m_freeSlots.push_back(bufferContext);
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef GRABBUFFERFACTORY_HPP
+#define GRABBUFFERFACTORY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pylon/PylonIncludes.h>
+
+/*
+    Hands Pylon grab buffers that are the storage of std::vectors owned by this factory.
+    Because link_dev::ImageT keeps its pixels in a std::vector<uint8_t>, a grabbed frame can be
+    swapped into an ImageT and serialized straight out of the grab buffer, then swapped back
+    before the grab result is released. See ConvertedFrame::returnBuffer().
+
+    Lending and giving back go through the factory, so that a buffer Pylon frees while it is
+    lent, e.g. when grabbing stops with frames in flight, is freed once it is given back.
+
+    The factory has to outlive the camera it is registered with (Pylon::Cleanup_None).
+*/
+class GrabBufferFactory : public Pylon::IBufferFactory
+{
+public:
+    GrabBufferFactory() = default;
+    virtual ~GrabBufferFactory() = default;
+
+    virtual void AllocateBuffer(size_t bufferSize, void** pCreatedBuffer, intptr_t& bufferContext);
+    virtual void FreeBuffer(void* pCreatedBuffer, intptr_t bufferContext);
+    virtual void DestroyBufferFactory();
+
+    // Whether the buffer of a grab result was made here.
+    bool owns(const Pylon::CGrabResultPtr& grabResult);
+
+    // Whether the buffer can be lent as an image of size bytes.
+    bool lendable(intptr_t bufferContext, size_t size);
+    // Swaps the storage of the buffer into data, until giveBack() swaps it back.
+    void lend(intptr_t bufferContext, std::vector<uint8_t>& data);
+    void giveBack(intptr_t bufferContext, std::vector<uint8_t>& data);
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<std::vector<uint8_t>> storage;
+        bool lent = false;
+        // Pylon freed the buffer while it was lent.
+        bool freed = false;
+    };
+
+    bool isAllocated(intptr_t bufferContext) const;
+    void release(intptr_t bufferContext);
+
+    std::mutex m_mutex;
+    // Indexed by buffer context.
+    std::vector<Slot> m_slots;
+    std::vector<intptr_t> m_freeSlots;
+};
+
+#endif
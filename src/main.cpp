@@ -6,8 +6,12 @@
  * SPDX-License-Identifier: MPL-2.0
  */
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <sstream>
 #include "baslercamdriver.h"
+#include "workerpool.h"
 
 int main(int argc, char** argv)
 {
@@ -17,23 +21,92 @@ int main(int argc, char** argv)
         
         DRAIVE::Link2::ConfigurationNode rootNode = nodeResources.getUserConfiguration();
         DRAIVE::Link2::OutputPin outputPin{nodeDiscovery, nodeResources, "basler-cam-output-pin"};
+        DRAIVE::Link2::InputPin controlPin{nodeDiscovery, nodeResources, "basler-cam-control-pin"};
        
         DRAIVE::Link2::SignalHandler signalHandler {};
         signalHandler.setReceiveSignalTimeout(-1);
+        // Besides the interrupt, the only signals are control messages.
+        signalHandler.addPin(&controlPin);
+
+        BaslerCamSettings settings;
+        std::stringstream cameraIDs(rootNode.getString("CameraID"));
+        std::string cameraID;
+        while(std::getline(cameraIDs, cameraID, ','))
+        {
+            cameraID.erase(std::remove_if(cameraID.begin(), cameraID.end(), ::isspace), cameraID.end());
+            if(!cameraID.empty())
+            {
+                settings.cameraIDs.push_back(cameraID);
+            }
+        }
+        settings.frameSource = rootNode.getString("FrameSource");
+        settings.syntheticReplayFile = rootNode.getString("SyntheticReplayFile");
+        settings.grabThreadAffinity = coreListFromString(rootNode.getString("GrabThreadAffinity"));
+        settings.frameWidth = rootNode.getUInt("ImageWidth");
+        settings.frameHeight = rootNode.getUInt("ImageHeight");
+        settings.frameRate = rootNode.getUInt("FrameRate");
+        settings.roi.offsetX = rootNode.getInt("OffsetX");
+        settings.roi.offsetY = rootNode.getInt("OffsetY");
+        settings.roi.binning = rootNode.getUInt("Binning");
+        settings.roi.decimation = rootNode.getUInt("Decimation");
+        settings.grabStrategy = grabStrategyFromString(rootNode.getString("GrabStrategy"));
+        settings.outputQueueSize = rootNode.getUInt("OutputQueueSize");
+        settings.grabBufferCount = rootNode.getUInt("GrabBufferCount");
+        settings.autoExposure = rootNode.getBoolean("AutoExposureContinuous");
+        settings.autoGain = rootNode.getBoolean("AutoGainContinuous");
+        settings.autoFunctionProfile = rootNode.getString("AutoFunctionProfile");
+        settings.exposureTimeUs = rootNode.getUInt("ExposureTimeUs");
+        settings.gainRaw = rootNode.getInt("GainRaw");
+        settings.networkInterfaceMTU = rootNode.getInt("NetworkInterfaceMTU");
+        settings.transport.autoTune = rootNode.getBoolean("TransportTuning");
+        settings.transport.linkSpeedMbps = rootNode.getUInt("LinkSpeedMbps");
+        settings.transport.receiveThreadPriority = rootNode.getInt("ReceiveThreadPriority");
+        settings.heartbeatTimeoutMs = rootNode.getUInt("HeartbeatTimeoutMs");
+        settings.configCache.mode = configCacheModeFromString(rootNode.getString("ConfigCache"));
+        settings.configCache.directory = rootNode.getString("ConfigCacheDirectory");
+        settings.outputFormat = rootNode.getString("OutputFormat");
+        settings.demosaicQuality = demosaicQualityFromString(rootNode.getString("DemosaicQuality"));
+        settings.demosaicInstructionSet = instructionSetFromString(rootNode.getString("DemosaicInstructionSet"));
+        settings.conversionThreads = rootNode.getUInt("ConversionThreads");
+        settings.conversionThreadAffinity = coreListFromString(rootNode.getString("ConversionThreadAffinity"));
+        settings.hugePageBuffers = rootNode.getBoolean("HugePageBuffers");
+
+        settings.pipeline.enabled = rootNode.getBoolean("PipelinedGrabbing");
+        settings.pipeline.convertQueueDepth = rootNode.getUInt("ConvertQueueDepth");
+        settings.pipeline.convertQueueOverflowPolicy = overflowPolicyFromString(rootNode.getString("ConvertQueueOverflowPolicy"));
+        settings.pipeline.publishQueueDepth = rootNode.getUInt("PublishQueueDepth");
+        settings.pipeline.publishQueueOverflowPolicy = overflowPolicyFromString(rootNode.getString("PublishQueueOverflowPolicy"));
+
+        settings.streams = streamsFromString(rootNode.getString("Streams"));
+
+        settings.recording.file = rootNode.getString("RecordingFile");
+        settings.recording.frames = rootNode.getUInt("RecordingFrames");
+        settings.recording.mode = recordingModeFromString(rootNode.getString("RecordingMode"));
+        settings.replay.file = rootNode.getString("ReplayFile");
+        settings.replay.speedPercent = rootNode.getUInt("ReplaySpeedPercent");
+
+        settings.compression.codec = codecFromString(rootNode.getString("Compression"));
+        settings.compression.jpegQuality = rootNode.getInt("JpegQuality");
+        settings.compression.threads = rootNode.getUInt("CompressionThreads");
+        settings.compression.threadAffinity = coreListFromString(rootNode.getString("CompressionThreadAffinity"));
+        settings.compression.publishUncompressed = rootNode.getBoolean("PublishUncompressed");
+
+        settings.sync.ptp = rootNode.getBoolean("PtpSync");
+        settings.sync.triggerSource = rootNode.getString("TriggerSource");
+        settings.sync.frameSetBundling = rootNode.getBoolean("FrameSetBundling");
+        settings.sync.frameSetToleranceUs = rootNode.getUInt("FrameSetToleranceUs");
+
+        settings.chunkMetadata = rootNode.getBoolean("ChunkMetadata");
+        settings.clockSyncIntervalMs = rootNode.getUInt("ClockSyncIntervalMs");
+
+        settings.telemetryIntervalMs = rootNode.getUInt("TelemetryIntervalMs");
 
         BaslerCamDriver baslercamdriver{signalHandler,
                                         nodeResources,
                                         nodeDiscovery,
                                         outputPin,
-                                        rootNode.getString("CameraID"),
-                                        rootNode.getUInt("ImageWidth"),
-                                        rootNode.getUInt("ImageHeight"),
-                                        rootNode.getUInt("FrameRate"),
-                                        rootNode.getBoolean("AutoExposureContinuous"),
-                                        rootNode.getBoolean("AutoGainContinuous"),
-                                        rootNode.getString("AutoFunctionProfile"),
-                                        rootNode.getInt("NetworkInterfaceMTU"),
-                                        rootNode.getString("OutputFormat"),
+                                        controlPin,
+                                        settings
                                         };
 
         baslercamdriver.run(); //Runs until interrupt signal is sent to the program.
@@ -0,0 +1,958 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "pylonframesource.h"
+
+using namespace Basler_GigECameraParams;
+
+void setUpCameraForAutoFunctions(Pylon::CBaslerGigEInstantCamera& camera)
+{
+    // Width and Height were already set in BaslerCamConfigEvents::OnOpened.
+
+    // Set the Auto Function AOI for luminance statistics.
+    // Currently, AutoFunctionAOISelector_AOI1 is predefined to gather
+    // luminance statistics.
+                    
+    camera.AutoFunctionAOISelector.SetValue(AutoFunctionAOISelector_AOI1);
+
+    camera.AutoFunctionAOIOffsetX.SetValue(camera.OffsetX.GetMin());
+    camera.AutoFunctionAOIOffsetY.SetValue(camera.OffsetY.GetMin());
+    camera.AutoFunctionAOIWidth.SetValue(camera.Width.GetMax());
+    camera.AutoFunctionAOIHeight.SetValue(camera.Height.GetMax());
+    
+    return;
+}
+
+void AutoGainOnce(Pylon::CBaslerGigEInstantCamera& camera)
+{
+    // Check whether the gain auto function is available.
+    if(!IsWritable(camera.GainAuto))
+    {
+        std::cout << "The camera does not support Gain Auto." << std::endl << std::endl;
+        return;
+    }
+    std::cout << "Initial Gain = " << camera.GainRaw.GetValue() << std::endl;
+    // Set the gain ranges for luminance control.
+    camera.AutoGainRawLowerLimit.SetValue(camera.GainRaw.GetMin());
+    camera.AutoGainRawUpperLimit.SetValue(camera.GainRaw.GetMax());
+
+    // When the "once" mode of operation is selected,
+    // the parameter values are automatically adjusted until the related image property
+    // reaches the target value. After the automatic parameter value adjustment is complete, the auto
+    // function will automatically be set to "off" and the new parameter value will be applied to the
+    // subsequently grabbed images.
+    camera.GainAuto.SetValue(GainAuto_Once);
+    std::cout << "Final Gain = " << camera.GainRaw.GetValue() << std::endl << std::endl;
+    return;
+}
+
+void AutoGainContinuous(Pylon::CBaslerGigEInstantCamera& camera)
+{
+    // Check whether the Gain Auto feature is available.
+    if ( !IsWritable( camera.GainAuto))
+    {
+        std::cout << "The camera does not support Gain Auto." << std::endl;
+        return;
+    }
+
+    // When "continuous" mode is selected, the parameter value is adjusted repeatedly while images are acquired.
+    // Depending on the current frame rate, the automatic adjustments will usually be carried out for
+    // every or every other image unless the camera's micro controller is kept busy by other tasks.
+    // The repeated automatic adjustment will proceed until the "once" mode of operation is used or
+    // until the auto function is set to "off", in which case the parameter value resulting from the latest
+    // automatic adjustment will operate unless the value is manually adjusted.
+    camera.GainAuto.SetValue(GainAuto_Continuous);
+    return;
+}
+
+void AutoExposureContinuous(Pylon::CBaslerGigEInstantCamera& camera)
+{
+    // Check whether the Exposure Auto feature is available.
+    if(!IsWritable(camera.ExposureAuto))
+    {
+        std::cout << "The camera does not support Exposure Auto." << std::endl;
+        return;
+    }
+
+    camera.ExposureAuto.SetValue(ExposureAuto_Continuous);
+    return;
+}
+
+// Turns auto exposure off and sets the exposure time, if one is given.
+void ManualExposure(Pylon::CBaslerGigEInstantCamera& camera, double exposureTimeUs)
+{
+    if(IsWritable(camera.ExposureAuto))
+    {
+        camera.ExposureAuto.SetValue(ExposureAuto_Off);
+    }
+    if(exposureTimeUs <= 0)
+    {
+        return;     // Keep whatever the camera has, e.g. what auto exposure arrived at.
+    }
+    if(!IsWritable(camera.ExposureTimeAbs))
+    {
+        std::cout << "The camera does not support setting the exposure time." << std::endl;
+        return;
+    }
+    camera.ExposureTimeAbs.SetValue(std::max(camera.ExposureTimeAbs.GetMin(), std::min(camera.ExposureTimeAbs.GetMax(), exposureTimeUs)));
+}
+
+// Turns auto gain off and sets the gain, if one is given.
+void ManualGain(Pylon::CBaslerGigEInstantCamera& camera, int64_t gainRaw)
+{
+    if(IsWritable(camera.GainAuto))
+    {
+        camera.GainAuto.SetValue(GainAuto_Off);
+    }
+    if(gainRaw < 0)
+    {
+        return;
+    }
+    if(!IsWritable(camera.GainRaw))
+    {
+        std::cout << "The camera does not support setting the gain." << std::endl;
+        return;
+    }
+    camera.GainRaw.SetValue(std::max(camera.GainRaw.GetMin(), std::min(camera.GainRaw.GetMax(), gainRaw)));
+}
+
+void printCameraDetails(Pylon::CBaslerGigEInstantCamera& camera)
+{
+    std::cout << "FullName: " <<  camera.GetDeviceInfo().GetFullName() << std::endl;
+    std::cout << "FriendlyName: " <<  camera.GetDeviceInfo().GetFriendlyName() << std::endl;
+    std::cout << "UserDefinedName:  " <<  camera.GetDeviceInfo().GetUserDefinedName() << std::endl;
+    std::cout << "InternalName: " <<  camera.GetDeviceInfo().GetInternalName() << std::endl;
+    std::cout << "ModelName: " <<  camera.GetDeviceInfo().GetModelName() << std::endl;
+    std::cout << "SerialNumber: " <<  camera.GetDeviceInfo().GetSerialNumber() << std::endl;
+    std::cout << std::endl;
+    return;
+}
+
+/*
+    Selects the first pixel format of the list the camera offers and returns its name. Which of
+    the four Bayer phases the sensor has depends on the camera model (and on odd offsets), so
+    for Bayer formats we take whatever is available. Packed formats are listed 12 bit first.
+*/
+std::string setPixelFormat(GenApi::INodeMap& nodemap, SourcePixelFormat format)
+{
+    Pylon::CEnumParameter pixelFormat(nodemap, "PixelFormat");
+    std::vector<const char*> candidates;
+    switch(format)
+    {
+        case SourcePixelFormat::Mono8:
+            candidates = { "Mono8" };
+            break;
+        case SourcePixelFormat::Bayer8:
+            candidates = { "BayerBG8", "BayerRG8", "BayerGB8", "BayerGR8" };
+            break;
+        case SourcePixelFormat::MonoPacked:
+            candidates = { "Mono12Packed", "Mono10Packed" };
+            break;
+        case SourcePixelFormat::BayerPacked:
+            candidates = { "BayerBG12Packed", "BayerRG12Packed", "BayerGB12Packed", "BayerGR12Packed",
+                           "BayerBG10Packed", "BayerRG10Packed", "BayerGB10Packed", "BayerGR10Packed" };
+            break;
+    }
+
+    std::string tried;
+    for(const char* candidate : candidates)
+    {
+        if(pixelFormat.CanSetValue(candidate))
+        {
+            pixelFormat.SetValue(candidate);
+            return candidate;
+        }
+        tried += tried.empty() ? candidate : std::string(", ") + candidate;
+    }
+    throw RUNTIME_EXCEPTION("The camera offers none of the pixel formats %hs.", tried.c_str());
+}
+
+/*
+    Turns on IEEE 1588 so that the timestamps of all cameras on the network come from one clock,
+    then waits (bounded) until the camera has settled as PTP master or slave.
+*/
+void enablePtp(GenApi::INodeMap& nodemap)
+{
+    Pylon::CBooleanParameter ieee1588(nodemap, "GevIEEE1588");
+    if(!ieee1588.IsWritable())
+    {
+        std::cout << "The camera does not support PTP." << std::endl;
+        return;
+    }
+    ieee1588.SetValue(true);
+
+    Pylon::CCommandParameter dataSetLatch(nodemap, "GevIEEE1588DataSetLatch");
+    Pylon::CEnumParameter statusLatched(nodemap, "GevIEEE1588StatusLatched");
+    std::string status = "Unknown";
+
+    for(int waited = 0; waited < PTP_LOCK_TIMEOUT_MS; waited += 500)
+    {
+        if(dataSetLatch.TryExecute() && statusLatched.IsReadable())
+        {
+            status = statusLatched.GetValue().c_str();
+            if(status.compare("Master") == 0 || status.compare("Slave") == 0)
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    std::cout << "PTP status: " << status << std::endl;
+}
+
+/*
+    Has the camera append timestamp, exposure time, gain and frame counter to every frame.
+    Returns false if the camera has no chunks at all.
+*/
+bool enableChunks(GenApi::INodeMap& nodemap)
+{
+    Pylon::CBooleanParameter chunkModeActive(nodemap, "ChunkModeActive");
+    if(!chunkModeActive.IsWritable())
+    {
+        std::cout << "The camera does not support chunks." << std::endl;
+        return false;
+    }
+    chunkModeActive.SetValue(true);
+
+    Pylon::CEnumParameter chunkSelector(nodemap, "ChunkSelector");
+    Pylon::CBooleanParameter chunkEnable(nodemap, "ChunkEnable");
+    for(const char* chunk : {"Timestamp", "ExposureTime", "GainAll", "Framecounter"})
+    {
+        if(chunkSelector.CanSetValue(chunk))
+        {
+            chunkSelector.SetValue(chunk);
+            chunkEnable.SetValue(true);
+        }
+        else
+        {
+            std::cout << "The camera has no " << chunk << " chunk." << std::endl;
+        }
+    }
+    return true;
+}
+
+/*
+    The chunk node map of a grab result is parsed from its buffer on the host, reading it does
+    not talk to the camera.
+*/
+void readChunks(GenApi::INodeMap& chunks, FrameInfo& info)
+{
+    Pylon::CIntegerParameter timestamp(chunks, "ChunkTimestamp");
+    Pylon::CFloatParameter exposureTime(chunks, "ChunkExposureTime");
+    Pylon::CIntegerParameter gain(chunks, "ChunkGainAll");
+    Pylon::CIntegerParameter frameCounter(chunks, "ChunkFramecounter");
+    if(timestamp.IsReadable())
+    {
+        info.cameraTimestamp = (uint64_t) timestamp.GetValue();
+    }
+    if(exposureTime.IsReadable())
+    {
+        info.exposureTimeUs = exposureTime.GetValue();
+    }
+    if(gain.IsReadable())
+    {
+        info.gainRaw = gain.GetValue();
+    }
+    if(frameCounter.IsReadable())
+    {
+        info.frameCounter = (uint64_t) frameCounter.GetValue();
+    }
+    info.hasChunks = true;
+}
+
+// Nanoseconds per tick of the camera clock as the camera states it, before there is a fit.
+double nominalNsPerTick(GenApi::INodeMap& nodemap)
+{
+    Pylon::CIntegerParameter tickFrequency(nodemap, "GevTimestampTickFrequency");
+    if(tickFrequency.IsReadable() && tickFrequency.GetValue() > 0)
+    {
+        return 1e9 / (double) tickFrequency.GetValue();
+    }
+    // Cameras without the feature count nanoseconds.
+    return 1.0;
+}
+
+/*
+    Latches the camera clock and reads the latched value, with the host clock read right before
+    and after the latch. Returns false if the camera cannot latch its clock.
+*/
+bool latchCameraClock(GenApi::INodeMap& nodemap, uint64_t& cameraTicks, int64_t& hostBefore, int64_t& hostAfter)
+{
+    // Cameras following SFNC 2 name the features differently.
+    bool gev = Pylon::CCommandParameter(nodemap, "GevTimestampControlLatch").IsWritable();
+    Pylon::CCommandParameter latch(nodemap, gev ? "GevTimestampControlLatch" : "TimestampLatch");
+    Pylon::CIntegerParameter value(nodemap, gev ? "GevTimestampValue" : "TimestampLatchValue");
+    if(!latch.IsWritable() || !value.IsReadable())
+    {
+        return false;
+    }
+    // Another thread must not latch or read the value in between.
+    GenApi::AutoLock lock(nodemap.GetLock());
+    hostBefore = systemClockNs();
+    latch.Execute();
+    hostAfter = systemClockNs();
+    cameraTicks = (uint64_t) value.GetValue();
+    return true;
+}
+
+/*
+    Makes every frame wait for a trigger: an I/O line shared by all cameras, or a GigE action
+    command that BaslerCamDriver broadcasts to all cameras at once.
+*/
+void configureTrigger(GenApi::INodeMap& nodemap, const std::string& triggerSource)
+{
+    Pylon::CEnumParameter(nodemap, "TriggerSelector").SetValue("FrameStart");
+    Pylon::CEnumParameter(nodemap, "TriggerMode").SetValue("On");
+
+    if(triggerSource.compare("ActionCommand") == 0)
+    {
+        Pylon::CEnumParameter(nodemap, "TriggerSource").SetValue("Action1");
+        Pylon::CIntegerParameter(nodemap, "ActionSelector").SetValue(1);
+        Pylon::CIntegerParameter(nodemap, "ActionDeviceKey").SetValue(ACTION_DEVICE_KEY);
+        Pylon::CIntegerParameter(nodemap, "ActionGroupKey").SetValue(ACTION_GROUP_KEY);
+        Pylon::CIntegerParameter(nodemap, "ActionGroupMask").SetValue(ACTION_GROUP_MASK);
+    }
+    else
+    {
+        Pylon::CEnumParameter(nodemap, "TriggerSource").SetValue(triggerSource.c_str());
+        Pylon::CEnumParameter(nodemap, "TriggerActivation").TrySetValue("RisingEdge");
+    }
+}
+
+/*
+    Everything the node applies to the camera, and what it is applied to. A cached configuration
+    is only used if this is the same as when it was stored.
+*/
+std::string configurationKey(const BaslerCamSettings& settings, const Pylon::CDeviceInfo& device, SourcePixelFormat format)
+{
+    std::ostringstream key;
+    key << "v" << CONFIG_CACHE_VERSION
+        << " " << device.GetModelName() << " " << device.GetDeviceVersion()
+        << " format " << (int) format
+        << " size " << settings.frameWidth << "x" << settings.frameHeight
+        << " rate " << settings.frameRate
+        << " offset " << settings.roi.offsetX << "," << settings.roi.offsetY
+        << " binning " << settings.roi.binning
+        << " decimation " << settings.roi.decimation
+        << " autoexposure " << settings.autoExposure
+        << " autogain " << settings.autoGain
+        << " profile " << settings.autoFunctionProfile
+        << " exposure " << settings.exposureTimeUs
+        << " gain " << settings.gainRaw
+        << " packet " << settings.networkInterfaceMTU
+        << " trigger " << settings.sync.triggerSource;
+    return key.str();
+}
+
+PylonFrameSource::PylonFrameSource(const BaslerCamSettings& settings, size_t cameraIndex,
+                                   Pylon::WaitObjectEx terminateWaitObj, Pylon::WaitObjectEx controlWaitObj) :
+                                   m_settings(settings),
+                                   m_serialNumber(settings.cameraIDs[cameraIndex]),
+                                   m_terminateWaitObj(terminateWaitObj),
+                                   m_controlWaitObj(controlWaitObj),
+                                   m_removedWaitObj(Pylon::WaitObjectEx::Create()),
+                                   m_removalEvents(m_removedWaitObj)
+{
+    m_startTime = steadyClockNs();
+    attach();
+    std::cout << "Found camera " << m_serialNumber << " in " << (steadyClockNs() - m_startTime) / 1000000 << " ms." << std::endl;
+}
+
+void PylonFrameSource::attach()
+{
+    // Only asks the GigE transport layer, and only for this one camera.
+    Pylon::CDeviceInfo filter;
+    filter.SetDeviceClass(Pylon::BaslerGigEDeviceClass);
+    filter.SetSerialNumber(m_serialNumber.c_str());
+    try
+    {
+        m_camera.Attach(Pylon::CTlFactory::GetInstance().CreateFirstDevice(filter));
+    }
+    catch(const Pylon::GenericException& e)
+    {
+        throw std::runtime_error("No camera with serial number " + m_serialNumber + " found!");
+    }
+}
+
+PylonFrameSource::~PylonFrameSource()
+{
+    stopClockSync();
+    stop();
+}
+
+BaslerCamConfigEvents* PylonFrameSource::newConfigEvents()
+{
+    return new BaslerCamConfigEvents(m_settings.frameWidth,
+                                     m_settings.frameHeight,
+                                     m_settings.frameRate,
+                                     m_settings.autoGain,
+                                     m_settings.roi,
+                                     &m_sensorReduction);
+}
+
+void PylonFrameSource::start(SourcePixelFormat format)
+{
+    int64_t configureStart = steadyClockNs();
+    m_format = format;
+    CameraConfigCache cache(m_settings.configCache, m_serialNumber,
+                            configurationKey(m_settings, m_camera.GetDeviceInfo(), format));
+
+    if(cache.available())
+    {
+        // The cache restores what OnOpened would apply, the camera is opened as it is.
+        m_camera.RegisterConfiguration((Pylon::CConfigurationEventHandler*) nullptr,
+                                       Pylon::RegistrationMode_ReplaceAll,
+                                       Pylon::Cleanup_None);
+    }
+    else
+    {
+        m_camera.RegisterConfiguration(newConfigEvents(),
+                                       Pylon::RegistrationMode_ReplaceAll,
+                                       Pylon::Cleanup_Delete);
+    }
+
+    m_removedWaitObj.Reset();
+    m_camera.RegisterConfiguration(&m_removalEvents, Pylon::RegistrationMode_Append, Pylon::Cleanup_None);
+
+    printCameraDetails(m_camera);
+    //Initialize wait objects. The grab result wait object is a new one after every reconnect.
+    m_waitObjects.RemoveAll();
+    m_waitObjects.Add(m_terminateWaitObj);
+    m_waitObjects.Add(m_removedWaitObj);
+    m_waitObjects.Add(m_controlWaitObj);
+    m_waitObjects.Add(m_camera.GetGrabResultWaitObject());
+
+    m_camera.SetBufferFactory(&m_grabBufferFactory, Pylon::Cleanup_None);
+
+    m_camera.Open();
+    m_camera.MaxNumBuffer = m_settings.grabBufferCount;
+    m_grabBuffers = m_settings.grabBufferCount;
+
+    // How long the camera waits for a sign of life from the host, and the host for one from
+    // the camera, before the connection counts as lost.
+    Pylon::CIntegerParameter(m_camera.GetTLNodeMap(), "HeartbeatTimeout").TrySetValue(m_settings.heartbeatTimeoutMs, Pylon::IntegerValueCorrection_Nearest);
+
+    GenApi::INodeMap& nodemap = m_camera.GetNodeMap();
+
+    std::string pixelFormat;
+    bool restored = cache.available() && cache.restore(nodemap, pixelFormat, m_sensorReduction);
+    if(!restored)
+    {
+        if(cache.available())
+        {
+            std::unique_ptr<BaslerCamConfigEvents>(newConfigEvents())->OnOpened(m_camera);
+        }
+        pixelFormat = configure(nodemap, format);
+        if(m_settings.configCache.mode != ConfigCacheMode::Off)
+        {
+            cache.store(nodemap, pixelFormat, m_sensorReduction);
+        }
+    }
+
+    if(m_settings.sync.ptp)
+    {
+        enablePtp(nodemap);
+    }
+
+    // Not part of the cached configuration, and after PTP, which sets the camera clock.
+    m_chunksActive = m_settings.chunkMetadata && enableChunks(nodemap);
+    if(m_settings.chunkMetadata && m_settings.clockSyncIntervalMs > 0)
+    {
+        startClockSync(nodemap);
+    }
+
+    if(isBayer(format))
+    {
+        m_bayerPattern = bayerPatternFromPixelFormat(pixelFormat);
+    }
+    if(isPacked(format))
+    {
+        m_bitDepth = pixelFormat.find("12Packed") != std::string::npos ? 12 : 10;
+        std::cout << "Pixel format: " << pixelFormat << std::endl;
+    }
+
+    if(m_settings.grabStrategy == Pylon::GrabStrategy_LatestImages)
+    {
+        m_camera.OutputQueueSize.SetValue(m_settings.outputQueueSize);
+    }
+
+    Pylon::CFloatParameter resultingFrameRate(nodemap, "ResultingFrameRateAbs");
+    if(resultingFrameRate.IsReadable())
+    {
+        // Exposure time, packet size and image size can all keep the camera below the configured rate.
+        std::cout << "Resulting frame rate: " << resultingFrameRate.GetValue()
+                  << " fps (configured " << m_settings.frameRate << " fps)" << std::endl;
+    }
+
+    if(m_settings.transport.autoTune)
+    {
+        m_grabBuffers = prepareTransport(m_camera, m_settings.transport, (double) m_settings.frameRate, heldBuffers(), m_settings.grabBufferCount);
+    }
+
+    std::cout << "Configured camera " << m_serialNumber << " in " << (steadyClockNs() - configureStart) / 1000000 << " ms"
+              << (restored ? " from the cache." : ".") << std::endl;
+
+    m_camera.StartGrabbing(m_settings.grabStrategy); 
+
+    if(m_settings.transport.autoTune)
+    {
+        balanceBandwidth(m_camera, m_settings.transport, (double) m_settings.frameRate, m_settings.cameraIDs.size());
+    }
+}
+
+/*
+    Takes the first reading of the camera clock right away, so that the first frames already
+    get a host timestamp, and the others on a thread of their own. Each reading is a round trip
+    to the camera, which would hold up RetrieveResult if the grab thread waited for it.
+*/
+void PylonFrameSource::startClockSync(GenApi::INodeMap& nodemap)
+{
+    stopClockSync();
+    m_clockSyncFailures.store(0, std::memory_order_relaxed);
+    m_clock.reset(nominalNsPerTick(nodemap));
+
+    uint64_t cameraTicks;
+    int64_t hostBefore, hostAfter;
+    if(!latchCameraClock(nodemap, cameraTicks, hostBefore, hostAfter))
+    {
+        std::cout << "Camera " << m_serialNumber << " cannot latch its clock, its timestamps are not mapped to the host clock." << std::endl;
+        return;
+    }
+    m_clock.addSample(cameraTicks, hostBefore, hostAfter);
+
+    m_clockSyncStopping = false;
+    m_clockSyncActive = true;
+    m_clockSyncThread = std::thread(&PylonFrameSource::clockSyncLoop, this);
+}
+
+void PylonFrameSource::stopClockSync()
+{
+    if(!m_clockSyncThread.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_clockMutex);
+        m_clockSyncStopping = true;
+    }
+    m_clockSyncWakeUp.notify_one();
+    m_clockSyncThread.join();
+    m_clockSyncActive = false;
+}
+
+/*
+    Adds a reading of the camera clock to the fit every ClockSyncIntervalMs. A reading that
+    fails, e.g. because the camera was just disconnected, only leaves the fit a little older,
+    it is counted for the telemetry.
+*/
+void PylonFrameSource::clockSyncLoop()
+{
+    std::chrono::milliseconds interval(m_settings.clockSyncIntervalMs);
+    std::unique_lock<std::mutex> lock(m_clockMutex);
+    while(!m_clockSyncWakeUp.wait_for(lock, interval, [this] { return m_clockSyncStopping; }))
+    {
+        lock.unlock();
+        uint64_t cameraTicks;
+        int64_t hostBefore, hostAfter;
+        bool latched = false;
+        try
+        {
+            latched = latchCameraClock(m_camera.GetNodeMap(), cameraTicks, hostBefore, hostAfter);
+        }
+        catch(const Pylon::GenericException& e)
+        {
+            if(m_clockSyncFailures.load(std::memory_order_relaxed) == 0)
+            {
+                std::cerr << "Reading the clock of camera " << m_serialNumber << " failed: " << e.what() << std::endl;
+            }
+        }
+        lock.lock();
+
+        if(latched)
+        {
+            m_clock.addSample(cameraTicks, hostBefore, hostAfter);
+        }
+        else
+        {
+            m_clockSyncFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Grab buffers that can be held after they were retrieved, beyond the one being converted.
+size_t PylonFrameSource::heldBuffers() const
+{
+    size_t held = 1;
+    if(m_settings.pipeline.enabled)
+    {
+        held += m_settings.pipeline.convertQueueDepth + m_settings.pipeline.publishQueueDepth;
+    }
+    if(m_settings.compression.codec != Codec::None)
+    {
+        held += m_settings.compression.queueDepth + m_settings.compression.threads;
+    }
+    if(!m_settings.recording.file.empty())
+    {
+        held += RECORDING_QUEUE_DEPTH;
+    }
+    return held;
+}
+
+/*
+    Applies the settings that are not taken care of in BaslerCamConfigEvents::OnOpened and
+    returns the pixel format that was selected.
+*/
+std::string PylonFrameSource::configure(GenApi::INodeMap& nodemap, SourcePixelFormat format)
+{
+    try {
+        setPacketSize(nodemap, m_settings.networkInterfaceMTU);
+    }
+    catch (const Pylon::GenericException& e)
+    {
+        throw RUNTIME_EXCEPTION("Could not apply configuration. const GenericException caught  msg=%hs", e.what());
+    }
+
+    applyExposureAndGain();
+
+    if(m_settings.sync.triggerSource.compare("FreeRun") != 0)
+    {
+        configureTrigger(nodemap, m_settings.sync.triggerSource);
+    }
+
+    return setPixelFormat(nodemap, format);
+}
+
+/*
+    Auto exposure and auto gain, or the fixed exposure time and gain while they are off. Also
+    called while grabbing, when they are changed on the control pin.
+*/
+void PylonFrameSource::applyExposureAndGain()
+{
+    if(m_settings.autoExposure || m_settings.autoGain)
+    {
+        setUpCameraForAutoFunctions(m_camera);
+
+        if(m_settings.autoGain)
+        {
+            if(m_settings.autoFunctionProfile.compare("MinimizeGain") == 0)
+            {
+                m_camera.AutoFunctionProfile.SetValue(AutoFunctionProfile_GainMinimum);
+            }    
+            AutoGainContinuous(m_camera);        
+        }
+
+        if(m_settings.autoExposure)
+        {
+            if(m_settings.autoFunctionProfile.compare("MinimizeExposure") == 0)
+            {
+                m_camera.AutoFunctionProfile.SetValue(AutoFunctionProfile_ExposureMinimum);
+            } 
+            AutoExposureContinuous(m_camera);
+        }
+    }
+
+    if(!m_settings.autoExposure)
+    {
+        ManualExposure(m_camera, (double) m_settings.exposureTimeUs);
+    }
+    if(!m_settings.autoGain)
+    {
+        ManualGain(m_camera, m_settings.gainRaw);
+    }
+}
+
+ControlResult PylonFrameSource::applyControl(const std::vector<ControlParameter>& parameters)
+{
+    // On a copy, so that nothing is applied if one of the parameters is wrong.
+    BaslerCamSettings settings = m_settings;
+    bool frameSizeChanged = false;
+    for(const ControlParameter& parameter : parameters)
+    {
+        if(applyControlParameter(settings, parameter) == ControlEffect::FrameSize)
+        {
+            frameSizeChanged = true;
+        }
+    }
+
+    bool exposureOrGainChanged = settings.autoExposure != m_settings.autoExposure ||
+                                 settings.autoGain != m_settings.autoGain ||
+                                 settings.autoFunctionProfile.compare(m_settings.autoFunctionProfile) != 0 ||
+                                 settings.exposureTimeUs != m_settings.exposureTimeUs ||
+                                 settings.gainRaw != m_settings.gainRaw;
+    bool frameRateChanged = settings.frameRate != m_settings.frameRate;
+    // A reconnect applies the new settings as well, unless they turn out not to work.
+    BaslerCamSettings previousSettings = m_settings;
+    m_settings = settings;
+
+    if(frameSizeChanged)
+    {
+        std::string failure;
+        try
+        {
+            restart();
+            return ControlResult::Restarted;
+        }
+        catch(const Pylon::GenericException& e)
+        {
+            failure = e.what();
+        }
+        catch(const std::exception& e)
+        {
+            failure = e.what();
+        }
+
+        // Grabbing was stopped, the camera has to get back to the frames it delivered before.
+        std::cerr << "Could not restart camera " << m_serialNumber << " with the new frame size, restoring the previous one." << std::endl;
+        m_settings = previousSettings;
+        try
+        {
+            restart();
+        }
+        catch(const Pylon::GenericException& e)
+        {
+            std::cerr << "Could not restore camera " << m_serialNumber << ", reconnecting it." << std::endl;
+            m_restoreFailed = true;
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << "Could not restore camera " << m_serialNumber << ", reconnecting it." << std::endl;
+            m_restoreFailed = true;
+        }
+        throw std::runtime_error(failure);
+    }
+
+    try
+    {
+        if(exposureOrGainChanged)
+        {
+            applyExposureAndGain();
+        }
+        if(frameRateChanged)
+        {
+            Pylon::CFloatParameter frameRate(m_camera.GetNodeMap(), "AcquisitionFrameRateAbs");
+            if(frameRate.IsWritable())
+            {
+                frameRate.SetValue((double) m_settings.frameRate, Pylon::FloatValueCorrection_ClipToRange);
+            }
+            if(m_settings.transport.autoTune)
+            {
+                // The camera's share of the link is spread over more or fewer frames now.
+                balanceBandwidth(m_camera, m_settings.transport, (double) m_settings.frameRate, m_settings.cameraIDs.size());
+            }
+        }
+    }
+    catch(...)
+    {
+        // Goes back to the exposure and gain it had, the frame rate was the last to change.
+        m_settings = previousSettings;
+        if(exposureOrGainChanged)
+        {
+            applyExposureAndGain();
+        }
+        throw;
+    }
+    return ControlResult::Applied;
+}
+
+/*
+    Stops grabbing, applies what depends on the frame size again and starts grabbing. The
+    camera stays open, so this only takes as long as the grab buffers need to be allocated.
+*/
+void PylonFrameSource::restart()
+{
+    int64_t restartStart = steadyClockNs();
+    stop();
+
+    std::unique_ptr<BaslerCamConfigEvents>(newConfigEvents())->OnOpened(m_camera);
+    // The auto function AOI follows the image size.
+    applyExposureAndGain();
+    if(isBayer(m_format))
+    {
+        // An odd offset moves the phase of the Bayer pattern.
+        m_bayerPattern = bayerPatternFromPixelFormat(Pylon::CEnumParameter(m_camera.GetNodeMap(), "PixelFormat").GetValue().c_str());
+    }
+
+    if(m_settings.transport.autoTune)
+    {
+        m_grabBuffers = prepareTransport(m_camera, m_settings.transport, (double) m_settings.frameRate, heldBuffers(), m_settings.grabBufferCount);
+    }
+    m_camera.StartGrabbing(m_settings.grabStrategy);
+    if(m_settings.transport.autoTune)
+    {
+        balanceBandwidth(m_camera, m_settings.transport, (double) m_settings.frameRate, m_settings.cameraIDs.size());
+    }
+
+    std::cout << "Restarted camera " << m_serialNumber << " with " << m_camera.Width.GetValue() << "x" << m_camera.Height.GetValue()
+              << " frames in " << (steadyClockNs() - restartStart) / 1000000 << " ms." << std::endl;
+}
+
+void PylonFrameSource::stop()
+{
+    m_grabResult.Release();
+    if(m_camera.IsGrabbing())
+    {
+        m_camera.StopGrabbing();
+    }
+}
+
+bool PylonFrameSource::reconnect()
+{
+    std::cerr << "Camera " << m_serialNumber << " was disconnected, reconnecting." << std::endl;
+    m_startTime = steadyClockNs();
+    m_firstFrameGrabbed = false;
+    m_restoreFailed = false;
+
+    // Grab results still held downstream keep their buffers, the buffer factory outlives the device.
+    m_grabResult.Release();
+    stopClockSync();
+    m_camera.DestroyDevice();
+
+    uint32_t delayMs = RECONNECT_MIN_DELAY_MS;
+    for(uint32_t attempt = 1; ; attempt++)
+    {
+        if(m_terminateWaitObj.Wait(delayMs))
+        {
+            return false;
+        }
+        try
+        {
+            attach();
+            start(m_format);
+            std::cout << "Reconnected camera " << m_serialNumber << " after " << attempt << " attempts in "
+                      << (steadyClockNs() - m_startTime) / 1000000 << " ms." << std::endl;
+            return true;
+        }
+        catch(const Pylon::GenericException& e)
+        {
+            // start() may have got as far as the clock thread, which must not outlive the device.
+            stopClockSync();
+            m_camera.DestroyDevice();
+        }
+        catch(const std::runtime_error& e)
+        {
+            stopClockSync();
+            m_camera.DestroyDevice();
+        }
+        delayMs = std::min(delayMs * 2, (uint32_t) RECONNECT_MAX_DELAY_MS);
+    }
+}
+
+GrabStatus PylonFrameSource::grab(RawFrame& frame, GrabError& error)
+{
+    if(m_camera.IsCameraDeviceRemoved() || m_restoreFailed)
+    {
+        return GrabStatus::Disconnected;
+    }
+    if(!m_camera.IsGrabbing())
+    {
+        return GrabStatus::Terminated;
+    }
+
+    if(m_settings.grabStrategy == Pylon::GrabStrategy_UpcomingImage)
+    {
+        // The grab engine only queues a buffer when RetrieveResult asks for one,
+        // so there is no wait object that could fire on its own.
+        if(m_terminateWaitObj.Wait(0))
+        {
+            return GrabStatus::Terminated;
+        }
+        if(!m_camera.RetrieveResult(UPCOMING_IMAGE_TIMEOUT_MS, m_grabResult, Pylon::TimeoutHandling_Return))
+        {
+            return m_camera.IsCameraDeviceRemoved() ? GrabStatus::Disconnected : GrabStatus::Timeout;
+        }
+    }
+    else
+    {
+        unsigned int index;
+        if(!m_waitObjects.WaitForAny(0xFFFFFFFF, &index))
+        {
+            std::cout << "This should not happen. Check wait Objects." << std::endl;
+            return GrabStatus::Terminated;
+        }
+        if(index == 0)  // Received a termination request
+        {
+            return GrabStatus::Terminated;
+        }
+        if(index == 1)  // Pylon noticed that the camera is gone
+        {
+            return GrabStatus::Disconnected;
+        }
+        if(index == 2)  // Control parameters were posted, they must not wait for the next trigger
+        {
+            return GrabStatus::Timeout;
+        }
+        // A grabbed buffer is available. Don't wait for timeout. We want good FPS.
+        if(!m_camera.RetrieveResult(0, m_grabResult, Pylon::TimeoutHandling_Return))
+        {
+            return GrabStatus::Timeout;
+        }
+    }
+
+    frame.info.retrieveTime = steadyClockNs();
+    frame.info.grabId = (int64_t) m_grabResult->GetID();
+    frame.info.skippedImages = m_grabResult->GetNumberOfSkippedImages();
+
+    if(!m_grabResult->GrabSucceeded())
+    {
+        error.code = m_grabResult->GetErrorCode();
+        error.description = m_grabResult->GetErrorDescription().c_str();
+        m_grabResult.Release();
+        return GrabStatus::Failed;
+    }
+
+    if(!m_firstFrameGrabbed)
+    {
+        std::cout << "Time to first frame of camera " << m_serialNumber << ": "
+                  << (frame.info.retrieveTime - m_startTime) / 1000000 << " ms." << std::endl;
+        m_firstFrameGrabbed = true;
+    }
+
+    frame.info.cameraTimestamp = m_grabResult->GetTimeStamp();
+    if(m_chunksActive && m_grabResult->IsChunkDataAvailable())
+    {
+        readChunks(m_grabResult->GetChunkDataNodeMap(), frame.info);
+    }
+    if(m_clockSyncActive)
+    {
+        std::lock_guard<std::mutex> lock(m_clockMutex);
+        frame.info.hostTimestamp = m_clock.toHost(frame.info.cameraTimestamp);
+    }
+    frame.grabResult = m_grabResult;
+    frame.buffer = (uint8_t *) m_grabResult->GetBuffer();
+    frame.width = m_grabResult->GetWidth();
+    frame.height = m_grabResult->GetHeight();
+    if(m_grabBufferFactory.owns(m_grabResult))
+    {
+        frame.bufferFactory = &m_grabBufferFactory;
+        frame.bufferContext = m_grabResult->GetBufferContext();
+    }
+    m_grabResult.Release();
+    return GrabStatus::Succeeded;
+}
+
+void PylonFrameSource::transportStatistics(TransportStatistics& statistics)
+{
+    if(m_camera.IsOpen() && !m_camera.IsCameraDeviceRemoved())
+    {
+        readTransportStatistics(m_camera, statistics);
+    }
+    statistics.clockSyncFailures = m_clockSyncFailures.load(std::memory_order_relaxed);
+}
+
+void PylonFrameSource::bufferCounts(uint32_t& readyBuffers, uint32_t& queuedBuffers)
+{
+    readyBuffers = (uint32_t) m_camera.NumReadyBuffers.GetValue();
+    queuedBuffers = (uint32_t) m_camera.NumQueuedBuffers.GetValue();
+}
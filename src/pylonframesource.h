@@ -0,0 +1,129 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef PYLONFRAMESOURCE_HPP
+#define PYLONFRAMESOURCE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "baslercamdriver.h"
+#include "cameraclock.h"
+#include "configcache.h"
+#include "gigetransport.h"
+#include "framesource.h"
+#include "grabbufferfactory.h"
+
+// Between attempts to reconnect a camera, doubling from the first to the last.
+#define RECONNECT_MIN_DELAY_MS 50
+#define RECONNECT_MAX_DELAY_MS 2000
+
+// Signals a wait object when Pylon notices that the camera is gone.
+class DeviceRemovalEvents : public Pylon::CConfigurationEventHandler
+{
+public:
+    explicit DeviceRemovalEvents(Pylon::WaitObjectEx removedWaitObj) : m_removedWaitObj(removedWaitObj)
+    {
+    }
+    void OnCameraDeviceRemoved(Pylon::CInstantCamera& camera)
+    {
+        m_removedWaitObj.Signal();
+    }
+
+private:
+    Pylon::WaitObjectEx m_removedWaitObj;
+};
+
+/*
+    Frames from a Basler GigE camera, found by its serial number. All camera configuration of
+    BaslerCamSettings is applied in start(), or restored from the configuration cache if it was
+    applied with the same settings before. When the camera goes away, grab() returns
+    Disconnected and reconnect() looks for it again with growing pauses in between.
+
+    Exposure, gain and frame rate can be changed while grabbing. A new region of interest,
+    binning or decimation restarts grabbing on the open camera.
+
+    With ChunkMetadata the camera appends timestamp, exposure time, gain and frame counter to
+    every frame, which grab() reads into the frame info from the buffer itself. Every
+    ClockSyncIntervalMs a thread of its own reads the camera clock to keep the mapping of camera
+    timestamps to the host clock up to date, so grab() never waits for the camera.
+*/
+class PylonFrameSource : public FrameSource
+{
+public:
+    // Throws if no camera with the serial number of camera cameraIndex is connected.
+    // grab() returns Timeout when controlWaitObj is signaled, so that the grab loop can apply
+    // control parameters while the camera waits for a trigger.
+    PylonFrameSource(const BaslerCamSettings& settings, size_t cameraIndex,
+                     Pylon::WaitObjectEx terminateWaitObj, Pylon::WaitObjectEx controlWaitObj);
+    virtual ~PylonFrameSource();
+
+    virtual void start(SourcePixelFormat format);
+    virtual void stop();
+    virtual GrabStatus grab(RawFrame& frame, GrabError& error);
+    virtual BayerPattern bayerPattern() const { return m_bayerPattern; }
+    virtual uint32_t bitDepth() const { return m_bitDepth; }
+    virtual SensorReduction sensorReduction() const { return m_sensorReduction; }
+    virtual size_t grabBuffers() const { return m_grabBuffers; }
+    virtual bool reconnect();
+    virtual ControlResult applyControl(const std::vector<ControlParameter>& parameters);
+    virtual void transportStatistics(TransportStatistics& statistics);
+    virtual void bufferCounts(uint32_t& readyBuffers, uint32_t& queuedBuffers);
+
+private:
+    // Throws if no camera with the serial number is connected.
+    void attach();
+    BaslerCamConfigEvents* newConfigEvents();
+    std::string configure(GenApi::INodeMap& nodemap, SourcePixelFormat format);
+    void applyExposureAndGain();
+    void restart();
+    void startClockSync(GenApi::INodeMap& nodemap);
+    void stopClockSync();
+    void clockSyncLoop();
+    size_t heldBuffers() const;
+
+    Pylon::PylonAutoInitTerm m_autoInitTerm;
+    BaslerCamSettings m_settings;
+    std::string m_serialNumber;
+    Pylon::WaitObjectEx m_terminateWaitObj;
+    Pylon::WaitObjectEx m_controlWaitObj;
+    Pylon::WaitObjectEx m_removedWaitObj;
+    DeviceRemovalEvents m_removalEvents;
+    Pylon::WaitObjects m_waitObjects;
+    // Declared before the camera so that it outlives all the buffers it hands out.
+    GrabBufferFactory m_grabBufferFactory;
+    Pylon::CBaslerGigEInstantCamera m_camera;
+    Pylon::CGrabResultPtr m_grabResult;
+    SourcePixelFormat m_format = SourcePixelFormat::Mono8;
+    BayerPattern m_bayerPattern = BayerPattern::BG;
+    uint32_t m_bitDepth = 8;
+    // GrabBufferCount, or what TransportTuning set instead.
+    size_t m_grabBuffers = 0;
+    // Filled in by BaslerCamConfigEvents when the camera is opened.
+    SensorReduction m_sensorReduction;
+    // When the camera was looked for, the time to the first frame is counted from here.
+    int64_t m_startTime = 0;
+    bool m_firstFrameGrabbed = false;
+    // A failed restart could not even go back to the previous settings, grab() then hands the
+    // camera to reconnect().
+    bool m_restoreFailed = false;
+    bool m_chunksActive = false;
+    // Only used if ClockSyncIntervalMs is set and the camera can latch its clock.
+    bool m_clockSyncActive = false;
+    std::thread m_clockSyncThread;
+    // Guards the clock, which the grab thread reads and the clock thread adds readings to.
+    std::mutex m_clockMutex;
+    std::condition_variable m_clockSyncWakeUp;
+    bool m_clockSyncStopping = false;
+    CameraClock m_clock;
+    std::atomic<uint64_t> m_clockSyncFailures{0};
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "recordingfile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char recordingMagic[8] = { 'L', 'D', 'B', 'A', 'S', 'R', 'E', 'C' };
+
+std::string recordingFileForCamera(const std::string& file, size_t cameraIndex)
+{
+    return cameraIndex == 0 ? file : file + "." + std::to_string(cameraIndex);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#if defined(_WIN32)
+
+void MappedFile::create(const std::string& path, uint64_t size)
+{
+    close();
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                         CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        throw std::runtime_error("Cannot create " + path);
+    }
+
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG) size;
+    m_mapping = SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) && SetEndOfFile(m_file) ?
+                CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, 0, 0, nullptr) : nullptr;
+    m_data = m_mapping != nullptr ? (uint8_t*) MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+    if(m_data == nullptr)
+    {
+        close();
+        throw std::runtime_error("Cannot allocate and map " + std::to_string(size) + " bytes for " + path);
+    }
+    m_size = size;
+}
+
+void MappedFile::openReadOnly(const std::string& path)
+{
+    close();
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        throw std::runtime_error("Cannot open " + path);
+    }
+
+    LARGE_INTEGER size;
+    m_mapping = GetFileSizeEx(m_file, &size) && size.QuadPart > 0 ?
+                CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    m_data = m_mapping != nullptr ? (uint8_t*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(m_data == nullptr)
+    {
+        close();
+        throw std::runtime_error("Cannot map " + path);
+    }
+    m_size = (uint64_t) size.QuadPart;
+}
+
+void MappedFile::close()
+{
+    if(m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if(m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if(m_file != nullptr)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+    m_size = 0;
+}
+
+#else
+
+void MappedFile::create(const std::string& path, uint64_t size)
+{
+    close();
+
+    m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(m_file < 0)
+    {
+        throw std::runtime_error("Cannot create " + path + ": " + std::strerror(errno));
+    }
+
+    int result = posix_fallocate(m_file, 0, (off_t) size);
+    if(result == EOPNOTSUPP || result == EINVAL)
+    {
+        // The file system cannot allocate ahead, at least make the file long enough.
+        result = ftruncate(m_file, (off_t) size) == 0 ? 0 : errno;
+    }
+    if(result != 0)
+    {
+        close();
+        throw std::runtime_error("Cannot allocate " + std::to_string(size) + " bytes for " + path + ": " + std::strerror(result));
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if(data == MAP_FAILED)
+    {
+        close();
+        throw std::runtime_error("Cannot map " + path + ": " + std::strerror(errno));
+    }
+    // Frames are written front to back, the kernel may write them back early.
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    m_data = (uint8_t*) data;
+    m_size = size;
+}
+
+void MappedFile::openReadOnly(const std::string& path)
+{
+    close();
+
+    m_file = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if(m_file < 0 || fstat(m_file, &status) != 0 || status.st_size == 0)
+    {
+        close();
+        throw std::runtime_error("Cannot open " + path);
+    }
+
+    void* data = mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+    if(data == MAP_FAILED)
+    {
+        close();
+        throw std::runtime_error("Cannot map " + path + ": " + std::strerror(errno));
+    }
+
+    m_data = (uint8_t*) data;
+    m_size = (uint64_t) status.st_size;
+}
+
+void MappedFile::close()
+{
+    if(m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    if(m_file >= 0)
+    {
+        ::close(m_file);
+        m_file = -1;
+    }
+    m_size = 0;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef RECORDINGFILE_HPP
+#define RECORDINGFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#define RECORDING_VERSION 1
+// Index and frame slots start on page boundaries.
+#define RECORDING_ALIGNMENT 4096
+
+/*
+    Layout of a recording, in host byte order:
+    RecordingHeader | slotCount RecordingIndexEntry | padding | slotCount frame slots of slotSize bytes.
+    Frame n goes to slot n % slotCount, its index entry has the same number. In a ring recording
+    the oldest frame is in slot framesWritten % slotCount once the file has wrapped.
+*/
+struct RecordingHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t pixelFormat;       // SourcePixelFormat the frames were grabbed in.
+    uint32_t bayerPattern;      // BayerPattern, for Bayer formats.
+    uint32_t bitDepth;
+    uint32_t ring;              // 1 if old frames were overwritten once the file was full.
+    uint32_t reserved;
+    uint64_t slotCount;
+    uint64_t slotSize;
+    uint64_t indexOffset;
+    uint64_t dataOffset;
+    uint64_t framesWritten;
+};
+
+struct RecordingIndexEntry
+{
+    int64_t grabId;
+    uint64_t cameraTimestamp;
+    int64_t retrieveTime;       // Host steady clock nanoseconds, used to pace the replay.
+    uint64_t offset;            // Of the frame, from the start of the file.
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+static_assert(std::is_trivially_copyable<RecordingHeader>::value, "RecordingHeader is written as is");
+static_assert(std::is_trivially_copyable<RecordingIndexEntry>::value, "RecordingIndexEntry is written as is");
+
+extern const char recordingMagic[8];
+
+// Camera 0 records to (and replays from) the file itself, camera n to file.n.
+std::string recordingFileForCamera(const std::string& file, size_t cameraIndex);
+
+/*
+    A whole file mapped into memory. Writes go to the page cache and the kernel writes them back
+    in the background, so whoever writes never waits for the disk unless memory runs out.
+*/
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Creates or truncates the file and allocates all of its size on disk up front, so that a
+    // full disk shows up here and not as a fault in the middle of a recording. Throws on failure.
+    void create(const std::string& path, uint64_t size);
+    void openReadOnly(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    uint8_t* data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+
+private:
+    uint8_t* m_data = nullptr;
+    uint64_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
+
+#endif
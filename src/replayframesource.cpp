@@ -0,0 +1,115 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include "replayframesource.h"
+#include "unpack.h"
+
+ReplayFrameSource::ReplayFrameSource(const ReplaySettings& settings, Pylon::WaitObjectEx terminateWaitObj) :
+                                     m_settings(settings),
+                                     m_terminateWaitObj(terminateWaitObj)
+{
+}
+
+void ReplayFrameSource::start(SourcePixelFormat format)
+{
+    m_file.openReadOnly(m_settings.file);
+
+    const RecordingHeader* header = (const RecordingHeader*) m_file.data();
+    if(m_file.size() < sizeof(RecordingHeader) ||
+       std::memcmp(header->magic, recordingMagic, sizeof(recordingMagic)) != 0 ||
+       header->version != RECORDING_VERSION ||
+       header->slotCount == 0 ||
+       header->indexOffset + header->slotCount * sizeof(RecordingIndexEntry) > m_file.size())
+    {
+        throw std::runtime_error(m_settings.file + " is not a recording of this node.");
+    }
+    if(header->pixelFormat != (uint32_t) format)
+    {
+        throw std::runtime_error(m_settings.file + " was recorded in a pixel format that does not fit OutputFormat.");
+    }
+
+    // Once a ring recording has wrapped, the oldest frame is the one that would have been overwritten next.
+    const RecordingIndexEntry* index = (const RecordingIndexEntry*) (m_file.data() + header->indexOffset);
+    uint64_t numberOfFrames = std::min(header->framesWritten, header->slotCount);
+    uint64_t oldest = header->framesWritten > header->slotCount ? header->framesWritten % header->slotCount : 0;
+
+    m_frames.clear();
+    for(uint64_t i = 0; i < numberOfFrames; i++)
+    {
+        const RecordingIndexEntry* entry = &index[(oldest + i) % header->slotCount];
+        uint64_t numberOfPixels = (uint64_t) entry->width * entry->height;
+        uint64_t frameSize = isPacked(format) ? Unpacker::packedSize(numberOfPixels) : numberOfPixels;
+        if(entry->size < frameSize || entry->offset + entry->size > m_file.size())
+        {
+            throw std::runtime_error(m_settings.file + " is damaged, frame " + std::to_string(i) + " lies outside of it.");
+        }
+        m_frames.push_back(entry);
+    }
+    if(m_frames.empty())
+    {
+        throw std::runtime_error(m_settings.file + " does not hold any frames.");
+    }
+
+    m_bayerPattern = (BayerPattern) header->bayerPattern;
+    m_bitDepth = header->bitDepth;
+    m_nextFrame = 0;
+    std::cout << "Replaying " << m_frames.size() << " frames from " << m_settings.file << std::endl;
+}
+
+void ReplayFrameSource::stop()
+{
+    m_frames.clear();
+    m_file.close();
+}
+
+GrabStatus ReplayFrameSource::grab(RawFrame& frame, GrabError& error)
+{
+    if(m_nextFrame == m_frames.size())
+    {
+        m_nextFrame = 0;
+    }
+    const RecordingIndexEntry* entry = m_frames[m_nextFrame];
+    if(m_nextFrame == 0)
+    {
+        m_playbackStart = steadyClockNs();
+    }
+
+    if(m_settings.speedPercent > 0)
+    {
+        // Same as the synthetic source: whole milliseconds on the wait object, then the rest precisely.
+        int64_t due = m_playbackStart + (entry->retrieveTime - m_frames.front()->retrieveTime) * 100 / m_settings.speedPercent;
+        int64_t remaining = due - steadyClockNs();
+        if(m_terminateWaitObj.Wait(remaining > 0 ? (unsigned int) (remaining / 1000000) : 0))
+        {
+            return GrabStatus::Terminated;
+        }
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(due)));
+    }
+    else if(m_terminateWaitObj.Wait(0))
+    {
+        return GrabStatus::Terminated;
+    }
+
+    frame.info.retrieveTime = steadyClockNs();
+    frame.info.cameraTimestamp = entry->cameraTimestamp;
+    frame.info.grabId = entry->grabId;
+    frame.info.skippedImages = 0;
+    frame.buffer = const_cast<uint8_t*>(m_file.data() + entry->offset);
+    frame.width = entry->width;
+    frame.height = entry->height;
+    frame.bufferFactory = nullptr;
+
+    m_nextFrame++;
+    return GrabStatus::Succeeded;
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef REPLAYFRAMESOURCE_HPP
+#define REPLAYFRAMESOURCE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "framesource.h"
+#include "recordingfile.h"
+
+struct ReplaySettings
+{
+    std::string file;
+    // 100 replays at the recorded rate, 200 twice as fast, 0 as fast as the frames are grabbed.
+    uint32_t speedPercent = 100;
+};
+
+/*
+    Plays a recording of FrameRecorder back in a loop, oldest frame first, paced by the times
+    the frames were originally retrieved. Frames are handed out straight from the mapped file.
+    The recording has to be in the pixel format the output format asks for.
+*/
+class ReplayFrameSource : public FrameSource
+{
+public:
+    ReplayFrameSource(const ReplaySettings& settings, Pylon::WaitObjectEx terminateWaitObj);
+
+    virtual void start(SourcePixelFormat format);
+    virtual void stop();
+    virtual GrabStatus grab(RawFrame& frame, GrabError& error);
+    virtual BayerPattern bayerPattern() const { return m_bayerPattern; }
+    virtual uint32_t bitDepth() const { return m_bitDepth; }
+
+private:
+    ReplaySettings m_settings;
+    Pylon::WaitObjectEx m_terminateWaitObj;
+    MappedFile m_file;
+    BayerPattern m_bayerPattern = BayerPattern::BG;
+    uint32_t m_bitDepth = 8;
+
+    // In the order they were recorded.
+    std::vector<const RecordingIndexEntry*> m_frames;
+    size_t m_nextFrame = 0;
+    int64_t m_playbackStart = 0;
+};
+
+#endif
@@ -0,0 +1,340 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef SPSCRING_HPP
+#define SPSCRING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/*
+    What a producer does when it finds the ring full.
+    DropOldest discards the oldest queued item so that the newest always gets in,
+    DropNewest discards the incoming item and Block waits until the consumer made room.
+*/
+enum class OverflowPolicy
+{
+    DropOldest,
+    DropNewest,
+    Block
+};
+
+inline OverflowPolicy overflowPolicyFromString(const std::string& policy)
+{
+    if(policy.compare("DropOldest") == 0)
+    {
+        return OverflowPolicy::DropOldest;
+    }
+    else if(policy.compare("DropNewest") == 0)
+    {
+        return OverflowPolicy::DropNewest;
+    }
+    else if(policy.compare("Block") == 0)
+    {
+        return OverflowPolicy::Block;
+    }
+    throw std::invalid_argument("Unknown overflow policy: " + policy);
+}
+
+/*
+    Bounded lock-free ring connecting exactly one producer thread with exactly one consumer thread.
+
+    Every slot carries a sequence number (the scheme of D. Vyukov's bounded queue) so that the
+    producer is also allowed to take items off the consumer end. That is what makes DropOldest
+    possible without a lock: the producer simply pops the oldest item itself and retries.
+    The mutex and condition variables are only touched when the consumer has run dry, or with
+    Block the producer found the ring full, and one of them goes to sleep.
+*/
+template <typename T>
+class SpscRing
+{
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t m_depth;
+    const OverflowPolicy m_policy;
+    std::unique_ptr<Slot[]> m_slots;
+
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) std::atomic<uint64_t> m_droppedCount;
+    std::atomic<int> m_sleepingConsumers;
+    std::atomic<int> m_sleepingProducers;
+    std::atomic<bool> m_closed;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    // Apart from m_sleepMutex, which pop() holds while it calls tryPop().
+    std::mutex m_spaceMutex;
+    std::condition_variable m_spaceAvailable;
+
+public:
+    SpscRing(size_t depth, OverflowPolicy policy) :
+             m_depth(depth),
+             m_policy(policy),
+             m_slots(new Slot[depth]),
+             m_head(0),
+             m_tail(0),
+             m_droppedCount(0),
+             m_sleepingConsumers(0),
+             m_sleepingProducers(0),
+             m_closed(false)
+    {
+        if(depth == 0)
+        {
+            throw std::invalid_argument("SpscRing depth must be at least 1.");
+        }
+
+        for(size_t i = 0; i < depth; i++)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /*
+        Producer side. Returns false if an item had to be dropped to honor the overflow policy
+        (or if the ring was closed while blocking).
+    */
+    bool push(T&& item)
+    {
+        bool nothingDropped = true;
+
+        while(!tryPush(item))
+        {
+            if(m_closed.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            switch(m_policy)
+            {
+                case OverflowPolicy::DropNewest:
+                {
+                    m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                case OverflowPolicy::DropOldest:
+                {
+                    T discarded;
+                    if(tryPopOldest(discarded))
+                    {
+                        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                        nothingDropped = false;
+                    }
+                    else
+                    {
+                        // The consumer claimed the oldest slot and is still moving it out.
+                        std::this_thread::yield();
+                    }
+                    break;
+                }
+                case OverflowPolicy::Block:
+                {
+                    waitForSpace();
+                    break;
+                }
+            }
+        }
+
+        // Pairs with the fence in pop(): either this sees the sleeping consumer, or the
+        // consumer sees the item before it waits.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_sleepingConsumers.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_wakeUp.notify_one();
+        }
+
+        return nothingDropped;
+    }
+
+    /*
+        Consumer side. Never waits, returns false if the ring is empty.
+    */
+    bool tryPop(T& item)
+    {
+        size_t position = m_head.load(std::memory_order_relaxed);
+
+        for(;;)
+        {
+            Slot& slot = m_slots[position % m_depth];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+
+            if(difference == 0)
+            {
+                if(m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    item = std::move(slot.value);
+                    // Release whatever the moved-from value still holds, e.g. a Pylon grab buffer.
+                    slot.value = T();
+                    slot.sequence.store(position + m_depth, std::memory_order_release);
+                    if(m_policy == OverflowPolicy::Block)
+                    {
+                        wakeProducer();
+                    }
+                    return true;
+                }
+            }
+            else if(difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /*
+        Consumer side. Waits up to timeout for an item, returns false on timeout or when the
+        ring was closed and fully drained.
+    */
+    bool pop(T& item, std::chrono::milliseconds timeout)
+    {
+        if(tryPop(item))
+        {
+            return true;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        m_sleepingConsumers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool received = false;
+        {
+            // The producer notifies under the same mutex, so an item pushed after the check
+            // below wakes the wait instead of slipping in between.
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            while(!(received = tryPop(item)) &&
+                  !m_closed.load(std::memory_order_acquire) &&
+                  m_wakeUp.wait_until(lock, deadline) != std::cv_status::timeout);
+        }
+        m_sleepingConsumers.fetch_sub(1);
+
+        return received || tryPop(item);
+    }
+
+    void close()
+    {
+        m_closed.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_wakeUp.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(m_spaceMutex);
+        m_spaceAvailable.notify_all();
+    }
+
+    bool isClosed() const
+    {
+        return m_closed.load(std::memory_order_acquire);
+    }
+
+    size_t size() const
+    {
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t head = m_head.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : 0;
+    }
+
+    size_t depth() const
+    {
+        return m_depth;
+    }
+
+    uint64_t droppedCount() const
+    {
+        return m_droppedCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    bool tryPush(T& item)
+    {
+        // Only one producer, so the tail needs no compare-and-swap.
+        size_t position = m_tail.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[position % m_depth];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if(sequence != position)
+        {
+            return false;
+        }
+
+        slot.value = std::move(item);
+        slot.sequence.store(position + 1, std::memory_order_release);
+        m_tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+        Producer side, for DropOldest on a full ring. Only takes the item the tail is about to
+        overwrite. Returns false if the consumer claimed it first, its slot is free in a moment;
+        popping whatever is at the head then would drop a frame for nothing.
+    */
+    bool tryPopOldest(T& item)
+    {
+        size_t position = m_tail.load(std::memory_order_relaxed) - m_depth;
+        Slot& slot = m_slots[position % m_depth];
+        if(slot.sequence.load(std::memory_order_acquire) != position + 1 ||
+           !m_head.compare_exchange_strong(position, position + 1, std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        item = std::move(slot.value);
+        slot.value = T();
+        slot.sequence.store(position + m_depth, std::memory_order_release);
+        return true;
+    }
+
+    bool spaceAvailable() const
+    {
+        size_t position = m_tail.load(std::memory_order_relaxed);
+        return m_slots[position % m_depth].sequence.load(std::memory_order_acquire) == position;
+    }
+
+    // Producer side, for Block. Sleeps until the consumer freed the slot at the tail.
+    void waitForSpace()
+    {
+        m_sleepingProducers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(m_spaceMutex);
+            m_spaceAvailable.wait(lock, [this] { return spaceAvailable() || m_closed.load(std::memory_order_acquire); });
+        }
+        m_sleepingProducers.fetch_sub(1);
+    }
+
+    // Pairs with the fence in waitForSpace(), like push() with pop().
+    void wakeProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_sleepingProducers.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_spaceMutex);
+            m_spaceAvailable.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include <opencv2/imgproc.hpp>
+#include "streamfanout.h"
+
+namespace
+{
+
+link_dev::Format streamFormatFromString(const std::string& format)
+{
+    if(format.compare("GRAY_U8") == 0) return link_dev::Format_GRAY_U8;
+    if(format.compare("RGB_U8") == 0) return link_dev::Format_RGB_U8;
+    if(format.compare("BGR_U8") == 0) return link_dev::Format_BGR_U8;
+    throw std::invalid_argument("Streams can be GRAY_U8, RGB_U8 or BGR_U8, not " + format);
+}
+
+int channelsOf(link_dev::Format format)
+{
+    return format == link_dev::Format_GRAY_U8 ? 1 : 3;
+}
+
+} // namespace
+
+std::vector<StreamSettings> streamsFromString(const std::string& streams)
+{
+    std::vector<StreamSettings> result;
+    std::stringstream ss(streams);
+    std::string entry;
+
+    while(std::getline(ss, entry, ','))
+    {
+        if(entry.empty())
+        {
+            continue;
+        }
+
+        std::stringstream fields(entry);
+        std::string field;
+        StreamSettings stream;
+
+        std::getline(fields, field, ':');
+        stream.format = streamFormatFromString(field);
+        while(std::getline(fields, field, ':'))
+        {
+            size_t x = field.find('x');
+            if(x != std::string::npos)
+            {
+                stream.width = (uint32_t) std::stoul(field.substr(0, x));
+                stream.height = (uint32_t) std::stoul(field.substr(x + 1));
+            }
+            else
+            {
+                stream.frameRateDivisor = (uint32_t) std::stoul(field);
+            }
+        }
+
+        if(stream.frameRateDivisor == 0 || (stream.width == 0) != (stream.height == 0))
+        {
+            throw std::invalid_argument("Invalid stream: " + entry);
+        }
+        result.push_back(stream);
+    }
+
+    if(result.size() > MAX_NUMBER_OF_STREAMS)
+    {
+        throw std::invalid_argument("At most " + std::to_string(MAX_NUMBER_OF_STREAMS) + " streams are supported.");
+    }
+    return result;
+}
+
+StreamFanOut::StreamFanOut(const std::vector<StreamSettings>& streams, link_dev::Format sourceFormat, PublishFunction publish) :
+                           m_streams(streams),
+                           m_sourceFormat(sourceFormat),
+                           m_publish(publish),
+                           m_images(streams.size())
+{
+    for(const StreamSettings& stream : m_streams)
+    {
+        if(channelsOf(stream.format) > channelsOf(m_sourceFormat))
+        {
+            throw std::invalid_argument("Color streams need a color OutputFormat.");
+        }
+    }
+}
+
+void StreamFanOut::process(const link_dev::ImageT& image)
+{
+    uint64_t frame = m_frames++;
+
+    cv::Mat source((int) image.height, (int) image.width, channelsOf(m_sourceFormat) == 1 ? CV_8UC1 : CV_8UC3,
+                   const_cast<uint8_t*>(image.data.data()));
+    // Size of what m_scaled holds for this frame, if anything.
+    int scaledWidth = 0, scaledHeight = 0;
+
+    for(size_t i = 0; i < m_streams.size(); i++)
+    {
+        const StreamSettings& stream = m_streams[i];
+        if(frame % stream.frameRateDivisor != 0)
+        {
+            continue;
+        }
+
+        int width = stream.width > 0 ? (int) stream.width : source.cols;
+        int height = stream.height > 0 ? (int) stream.height : source.rows;
+        bool sameSize = width == source.cols && height == source.rows;
+        int interpolation = width < source.cols ? cv::INTER_AREA : cv::INTER_LINEAR;
+
+        link_dev::ImageT& output = m_images[i];
+        output.width = (uint32_t) width;
+        output.height = (uint32_t) height;
+        output.format = stream.format;
+        output.data.resize((size_t) width * height * channelsOf(stream.format));
+        cv::Mat destination(height, width, channelsOf(stream.format) == 1 ? CV_8UC1 : CV_8UC3, output.data.data());
+
+        if(stream.format == m_sourceFormat && sameSize)
+        {
+            source.copyTo(destination);
+        }
+        else if(stream.format == m_sourceFormat)
+        {
+            cv::resize(source, destination, destination.size(), 0, 0, interpolation);
+        }
+        else
+        {
+            // Scaling first leaves fewer pixels to convert.
+            cv::Mat scaled = source;
+            if(!sameSize)
+            {
+                if(width != scaledWidth || height != scaledHeight)
+                {
+                    cv::resize(source, m_scaled, cv::Size(width, height), 0, 0, interpolation);
+                    scaledWidth = width;
+                    scaledHeight = height;
+                }
+                scaled = m_scaled;
+            }
+
+            int conversion = cv::COLOR_RGB2BGR;
+            if(stream.format == link_dev::Format_GRAY_U8)
+            {
+                conversion = m_sourceFormat == link_dev::Format_RGB_U8 ? cv::COLOR_RGB2GRAY : cv::COLOR_BGR2GRAY;
+            }
+            cv::cvtColor(scaled, destination, conversion);
+        }
+
+        m_publish(i, output);
+    }
+}
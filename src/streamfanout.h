@@ -0,0 +1,68 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef STREAMFANOUT_HPP
+#define STREAMFANOUT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "Image_generated.h"
+
+#define MAX_NUMBER_OF_STREAMS 2
+
+// One additional output next to the image offer.
+struct StreamSettings
+{
+    link_dev::Format format = link_dev::Format_GRAY_U8;
+    // 0 keeps the size of the image offer.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Only every divisor-th frame goes out on the stream.
+    uint32_t frameRateDivisor = 1;
+};
+
+/*
+    Parses a comma separated list of FORMAT[:WIDTHxHEIGHT][:DIVISOR] entries, e.g.
+    "GRAY_U8:320x256:6". Throws std::invalid_argument if an entry makes no sense.
+*/
+std::vector<StreamSettings> streamsFromString(const std::string& streams);
+
+/*
+    Derives the images of the additional streams from the image that is about to be published
+    on the image offer, so that a camera is only grabbed and demosaiced once however many
+    streams there are. Frames are first scaled and then color converted, and streams of the
+    same size share the scaled image. A frame a stream skips costs one comparison.
+    Color streams need a color image offer.
+*/
+class StreamFanOut
+{
+public:
+    using PublishFunction = std::function<void(size_t stream, link_dev::ImageT& image)>;
+
+    // Throws std::invalid_argument if a stream cannot be derived from images of sourceFormat.
+    StreamFanOut(const std::vector<StreamSettings>& streams, link_dev::Format sourceFormat, PublishFunction publish);
+
+    // From the publish stage, one frame after the other.
+    void process(const link_dev::ImageT& image);
+
+private:
+    std::vector<StreamSettings> m_streams;
+    link_dev::Format m_sourceFormat;
+    PublishFunction m_publish;
+    uint64_t m_frames = 0;
+
+    // Reused from frame to frame, so that the streams do not allocate once they run.
+    std::vector<link_dev::ImageT> m_images;
+    cv::Mat m_scaled;
+};
+
+#endif
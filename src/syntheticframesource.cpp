@@ -0,0 +1,200 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include "syntheticframesource.h"
+#include "unpack.h"
+
+SyntheticFrameSource::SyntheticFrameSource(const SyntheticSourceSettings& settings, Pylon::WaitObjectEx terminateWaitObj) :
+                                           m_settings(settings),
+                                           m_terminateWaitObj(terminateWaitObj)
+{
+    if(m_settings.width < 2 || m_settings.height < 2)
+    {
+        throw std::invalid_argument("Synthetic frames must be at least 2x2 pixels.");
+    }
+}
+
+void SyntheticFrameSource::start(SourcePixelFormat format)
+{
+    m_format = format;
+    if(m_settings.replayFile.empty())
+    {
+        generateFrames();
+    }
+    else
+    {
+        loadReplayFile();
+    }
+
+    m_grabbedFrames = 0;
+    m_nextFrameTime = steadyClockNs();
+}
+
+void SyntheticFrameSource::stop()
+{
+}
+
+/*
+    A color scene (horizontal red ramp, vertical green ramp, blue bars) that moves one eighth of
+    the width per frame, with a little noise so that nothing compresses unrealistically well.
+    For Bayer output every pixel keeps only the channel its filter lets through. Packed frames
+    get four more bits of noise below the 8 bit value.
+*/
+void SyntheticFrameSource::generateFrames()
+{
+    uint32_t width = m_settings.width;
+    uint32_t height = m_settings.height;
+    bool bayer = isBayer(m_format);
+    bool packed = isPacked(m_format);
+
+    // Channel (0 = R, 1 = G, 2 = B) at the top-left, top-right, bottom-left and bottom-right of a 2x2 cell.
+    int cfa[4] = {0, 1, 1, 2};
+    switch(m_settings.bayerPattern)
+    {
+        case BayerPattern::BG: cfa[0] = 2; cfa[1] = 1; cfa[2] = 1; cfa[3] = 0; break;
+        case BayerPattern::GB: cfa[0] = 1; cfa[1] = 2; cfa[2] = 0; cfa[3] = 1; break;
+        case BayerPattern::GR: cfa[0] = 1; cfa[1] = 0; cfa[2] = 2; cfa[3] = 1; break;
+        case BayerPattern::RG: cfa[0] = 0; cfa[1] = 1; cfa[2] = 1; cfa[3] = 2; break;
+    }
+
+    uint32_t noise = 0x12345678;
+    size_t numberOfPixels = (size_t) width * height;
+    m_frames.assign(SYNTHETIC_FRAME_COUNT, std::vector<uint8_t>(packed ? Unpacker::packedSize(numberOfPixels) : numberOfPixels));
+
+    for(size_t frameIndex = 0; frameIndex < m_frames.size(); frameIndex++)
+    {
+        uint32_t shift = (uint32_t) (frameIndex * width / SYNTHETIC_FRAME_COUNT);
+        uint8_t* pixels = m_frames[frameIndex].data();
+
+        for(uint32_t y = 0; y < height; y++)
+        {
+            for(uint32_t x = 0; x < width; x++)
+            {
+                uint32_t movedX = (x + shift) % width;
+                int channels[3];
+                channels[0] = (int) (movedX * 255 / (width - 1));
+                channels[1] = (int) (y * 255 / (height - 1));
+                channels[2] = ((movedX / 32) % 2 == 0) ? 220 : 40;
+
+                noise ^= noise << 13;
+                noise ^= noise >> 17;
+                noise ^= noise << 5;
+                int jitter = (int) (noise & 7) - 4;
+
+                int value;
+                if(bayer)
+                {
+                    value = channels[cfa[(y % 2) * 2 + (x % 2)]];
+                }
+                else
+                {
+                    value = (channels[0] * 77 + channels[1] * 150 + channels[2] * 29) >> 8;
+                }
+                value += jitter;
+                value = value < 0 ? 0 : (value > 255 ? 255 : value);
+
+                size_t pixel = (size_t) y * width + x;
+                if(!packed)
+                {
+                    pixels[pixel] = (uint8_t) value;
+                    continue;
+                }
+
+                uint8_t* pair = pixels + 3 * (pixel / 2);
+                int lowBits = (int) (noise >> 8) & 0x0F;
+                if(pixel % 2 == 0)
+                {
+                    pair[0] = (uint8_t) value;
+                    pair[1] = (uint8_t) ((pair[1] & 0xF0) | lowBits);
+                }
+                else
+                {
+                    pair[2] = (uint8_t) value;
+                    pair[1] = (uint8_t) ((pair[1] & 0x0F) | (lowBits << 4));
+                }
+            }
+        }
+    }
+}
+
+void SyntheticFrameSource::loadReplayFile()
+{
+    std::ifstream file(m_settings.replayFile, std::ios::binary);
+    if(!file)
+    {
+        throw std::runtime_error("Cannot open replay file " + m_settings.replayFile);
+    }
+
+    size_t frameSize = (size_t) m_settings.width * m_settings.height;
+    if(isPacked(m_format))
+    {
+        frameSize = Unpacker::packedSize(frameSize);
+    }
+    m_frames.clear();
+
+    for(;;)
+    {
+        std::vector<uint8_t> pixels(frameSize);
+        if(!file.read((char*) pixels.data(), (std::streamsize) frameSize))
+        {
+            break;
+        }
+        m_frames.push_back(std::move(pixels));
+    }
+
+    if(m_frames.empty())
+    {
+        throw std::runtime_error("Replay file " + m_settings.replayFile + " does not hold a single " +
+                                 std::to_string(m_settings.width) + "x" + std::to_string(m_settings.height) + " frame.");
+    }
+    std::cout << "Replaying " << m_frames.size() << " frames from " << m_settings.replayFile << std::endl;
+}
+
+GrabStatus SyntheticFrameSource::grab(RawFrame& frame, GrabError& error)
+{
+    if(m_settings.frameLimit > 0 && m_grabbedFrames >= m_settings.frameLimit)
+    {
+        return GrabStatus::Terminated;
+    }
+
+    if(m_settings.frameRate > 0.0)
+    {
+        // Sleep through whole milliseconds on the wait object so that termination still gets
+        // through, then the rest precisely.
+        m_nextFrameTime += (int64_t) (1e9 / m_settings.frameRate);
+        int64_t remaining = m_nextFrameTime - steadyClockNs();
+        if(m_terminateWaitObj.Wait(remaining > 0 ? (unsigned int) (remaining / 1000000) : 0))
+        {
+            return GrabStatus::Terminated;
+        }
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(m_nextFrameTime)));
+    }
+    else if(m_terminateWaitObj.Wait(0))
+    {
+        return GrabStatus::Terminated;
+    }
+
+    const std::vector<uint8_t>& pixels = m_frames[m_grabbedFrames % m_frames.size()];
+
+    frame.info.retrieveTime = steadyClockNs();
+    frame.info.cameraTimestamp = (uint64_t) frame.info.retrieveTime;
+    frame.info.grabId = (int64_t) m_grabbedFrames;
+    frame.info.skippedImages = 0;
+    frame.buffer = const_cast<uint8_t*>(pixels.data());
+    frame.width = m_settings.width;
+    frame.height = m_settings.height;
+    frame.bufferFactory = nullptr;
+
+    m_grabbedFrames++;
+    return GrabStatus::Succeeded;
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef SYNTHETICFRAMESOURCE_HPP
+#define SYNTHETICFRAMESOURCE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "framesource.h"
+
+#define SYNTHETIC_FRAME_COUNT 8
+
+struct SyntheticSourceSettings
+{
+    uint32_t width = 640;
+    uint32_t height = 480;
+    // Frames per second, 0 delivers them as fast as they are grabbed.
+    double frameRate = 24.0;
+    BayerPattern bayerPattern = BayerPattern::RG;
+    // Raw frames of width x height bytes each (12 bit packed: one and a half bytes per pixel),
+    // back to back. Empty generates a test pattern.
+    std::string replayFile;
+    // Terminate after that many frames, 0 runs until stop().
+    uint64_t frameLimit = 0;
+};
+
+/*
+    Pretends to be a camera, so that everything behind the grab can run and be measured
+    without one. Delivers either a moving test pattern (Mono8, or a color scene sampled through
+    a Bayer filter, packed to 12 bit if asked for) or the frames of a replay file in a loop,
+    paced to the frame rate.
+    The frames are prepared in start() and never written to afterwards, so a frame may be held
+    in a queue for as long as it takes.
+*/
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    SyntheticFrameSource(const SyntheticSourceSettings& settings, Pylon::WaitObjectEx terminateWaitObj);
+
+    virtual void start(SourcePixelFormat format);
+    virtual void stop();
+    virtual GrabStatus grab(RawFrame& frame, GrabError& error);
+    virtual BayerPattern bayerPattern() const { return m_settings.bayerPattern; }
+    virtual uint32_t bitDepth() const { return isPacked(m_format) ? 12 : 8; }
+
+private:
+    void generateFrames();
+    void loadReplayFile();
+
+    SyntheticSourceSettings m_settings;
+    SourcePixelFormat m_format = SourcePixelFormat::Mono8;
+    Pylon::WaitObjectEx m_terminateWaitObj;
+    std::vector<std::vector<uint8_t>> m_frames;
+    uint64_t m_grabbedFrames = 0;
+    int64_t m_nextFrameTime = 0;
+};
+
+#endif
@@ -0,0 +1,322 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <algorithm>
+#include "telemetry.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+const char* telemetryStageName(TelemetryStage stage)
+{
+    switch(stage)
+    {
+        case TelemetryStage::Queue: return "Queue";
+        case TelemetryStage::Convert: return "Convert";
+        case TelemetryStage::Handoff: return "Handoff";
+        case TelemetryStage::Publish: return "Publish";
+        case TelemetryStage::Total: return "Total";
+        default: return "Unknown";
+    }
+}
+
+LatencyHistogram::LatencyHistogram() :
+                                   m_maxUs(0)
+{
+    for(std::atomic<uint64_t>& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+/*
+    Values below 8 us get a bucket each. Above that every power of two is split into
+    LATENCY_HISTOGRAM_SUB_BUCKETS buckets by the three bits after the leading one.
+*/
+size_t LatencyHistogram::bucketOf(uint64_t latencyUs)
+{
+    if(latencyUs < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (size_t) latencyUs;
+    }
+
+#if defined(_MSC_VER)
+    unsigned long leadingBitIndex;
+    _BitScanReverse64(&leadingBitIndex, latencyUs);
+    int leadingBit = (int) leadingBitIndex;
+#else
+    int leadingBit = 63 - __builtin_clzll(latencyUs);
+#endif
+    size_t subBucket = (size_t) (latencyUs >> (leadingBit - 3)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+    size_t bucket = (size_t) (leadingBit - 2) * LATENCY_HISTOGRAM_SUB_BUCKETS + subBucket;
+    return std::min<size_t>(bucket, LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+float LatencyHistogram::valueOf(size_t bucket)
+{
+    if(bucket < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (float) bucket;
+    }
+
+    int shift = (int) (bucket / LATENCY_HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t lowerBound = (uint64_t) (LATENCY_HISTOGRAM_SUB_BUCKETS + bucket % LATENCY_HISTOGRAM_SUB_BUCKETS) << shift;
+    uint64_t width = (uint64_t) 1 << shift;
+    return (float) lowerBound + (float) width / 2.0f;
+}
+
+void LatencyHistogram::record(int64_t latencyNs)
+{
+    uint64_t latencyUs = latencyNs > 0 ? (uint64_t) latencyNs / 1000 : 0;
+    m_buckets[bucketOf(latencyUs)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t maxUs = m_maxUs.load(std::memory_order_relaxed);
+    while(latencyUs > maxUs && !m_maxUs.compare_exchange_weak(maxUs, latencyUs, std::memory_order_relaxed));
+}
+
+LatencyHistogram::Summary LatencyHistogram::snapshotAndReset()
+{
+    std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> counts;
+    Summary summary;
+
+    for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        counts[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.maxUs = (float) m_maxUs.exchange(0, std::memory_order_relaxed);
+
+    if(summary.count == 0)
+    {
+        return summary;
+    }
+
+    uint64_t p50Rank = (summary.count + 1) / 2;
+    uint64_t p99Rank = std::max<uint64_t>((summary.count * 99 + 99) / 100, 1);
+    uint64_t seen = 0;
+    bool p50Found = false;
+
+    for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += counts[i];
+        if(!p50Found && seen >= p50Rank)
+        {
+            summary.p50Us = valueOf(i);
+            p50Found = true;
+        }
+        if(seen >= p99Rank)
+        {
+            summary.p99Us = valueOf(i);
+            break;
+        }
+    }
+
+    // The bucket middle can overshoot the largest value that actually landed in it.
+    summary.p50Us = std::min(summary.p50Us, summary.maxUs);
+    summary.p99Us = std::min(summary.p99Us, summary.maxUs);
+    return summary;
+}
+
+CameraTelemetry::CameraTelemetry(const std::string& serialNumber) :
+                                 m_serialNumber(serialNumber),
+                                 m_frames(0),
+                                 m_skippedImages(0),
+                                 m_idGaps(0),
+                                 m_otherErrors(0),
+                                 m_gaugesRequested(true),
+                                 m_readyBuffers(0),
+                                 m_queuedBuffers(0),
+                                 m_convertQueueDepth(0),
+                                 m_publishQueueDepth(0),
+                                 m_convertQueueDrops(0),
+                                 m_publishQueueDrops(0),
+                                 m_failedBuffers(0),
+                                 m_bufferUnderruns(0),
+                                 m_failedPackets(0),
+                                 m_resendRequests(0),
+                                 m_resentPackets(0),
+                                 m_clockSyncFailures(0),
+                                 m_disconnectTime(0),
+                                 m_disconnects(0),
+                                 m_reconnects(0),
+                                 m_outageNs(0),
+                                 m_lastOutageNs(0)
+{
+    for(size_t i = 0; i < TELEMETRY_ERROR_CODE_SLOTS; i++)
+    {
+        m_errorCodes[i].store(0, std::memory_order_relaxed);
+        m_errorCounts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void CameraTelemetry::recordGrabResult(int64_t grabId, uint64_t skippedImages)
+{
+    if(skippedImages > 0)
+    {
+        m_skippedImages.fetch_add(skippedImages, std::memory_order_relaxed);
+    }
+
+    // Skipped images still use up IDs, only what is left over was lost on the way.
+    if(m_lastGrabId >= 0 && grabId > m_lastGrabId + 1 + (int64_t) skippedImages)
+    {
+        m_idGaps.fetch_add((uint64_t) (grabId - m_lastGrabId - 1 - (int64_t) skippedImages), std::memory_order_relaxed);
+    }
+    m_lastGrabId = grabId;
+}
+
+void CameraTelemetry::recordGrabError(uint32_t errorCode)
+{
+    for(size_t i = 0; i < TELEMETRY_ERROR_CODE_SLOTS; i++)
+    {
+        uint32_t code = m_errorCodes[i].load(std::memory_order_relaxed);
+        if(code == 0)
+        {
+            // Claim the free slot. If another thread was faster, look at what it put there.
+            if(m_errorCodes[i].compare_exchange_strong(code, errorCode, std::memory_order_relaxed))
+            {
+                code = errorCode;
+            }
+        }
+        if(code == errorCode)
+        {
+            m_errorCounts[i].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    m_otherErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CameraTelemetry::recordDisconnect()
+{
+    m_disconnects.fetch_add(1, std::memory_order_relaxed);
+    m_disconnectTime.store(steadyClockNs(), std::memory_order_relaxed);
+}
+
+void CameraTelemetry::recordReconnect()
+{
+    uint64_t outageNs = (uint64_t) (steadyClockNs() - m_disconnectTime.exchange(0, std::memory_order_relaxed));
+    m_outageNs.fetch_add(outageNs, std::memory_order_relaxed);
+    m_lastOutageNs.store(outageNs, std::memory_order_relaxed);
+    m_reconnects.fetch_add(1, std::memory_order_relaxed);
+
+    // The grab result IDs start over with the new connection.
+    m_lastGrabId = -1;
+}
+
+void CameraTelemetry::recordRestart()
+{
+    // The grab result IDs start over with StartGrabbing.
+    m_lastGrabId = -1;
+}
+
+void CameraTelemetry::recordPublished(const FrameInfo& info, int64_t publishEndTime)
+{
+    m_frames.fetch_add(1, std::memory_order_relaxed);
+
+    m_latencies[(size_t) TelemetryStage::Queue].record(info.convertStart - info.retrieveTime);
+    m_latencies[(size_t) TelemetryStage::Convert].record(info.convertEnd - info.convertStart);
+    m_latencies[(size_t) TelemetryStage::Handoff].record(info.publishStart - info.convertEnd);
+    m_latencies[(size_t) TelemetryStage::Publish].record(publishEndTime - info.publishStart);
+    m_latencies[(size_t) TelemetryStage::Total].record(publishEndTime - info.retrieveTime);
+}
+
+void CameraTelemetry::setGauges(uint32_t readyBuffers, uint32_t queuedBuffers,
+                                uint32_t convertQueueDepth, uint32_t publishQueueDepth,
+                                uint64_t convertQueueDrops, uint64_t publishQueueDrops)
+{
+    m_readyBuffers.store(readyBuffers, std::memory_order_relaxed);
+    m_queuedBuffers.store(queuedBuffers, std::memory_order_relaxed);
+    m_convertQueueDepth.store(convertQueueDepth, std::memory_order_relaxed);
+    m_publishQueueDepth.store(publishQueueDepth, std::memory_order_relaxed);
+    m_convertQueueDrops.store(convertQueueDrops, std::memory_order_relaxed);
+    m_publishQueueDrops.store(publishQueueDrops, std::memory_order_relaxed);
+}
+
+void CameraTelemetry::setTransportStatistics(const TransportStatistics& statistics)
+{
+    m_failedBuffers.store(statistics.failedBuffers, std::memory_order_relaxed);
+    m_bufferUnderruns.store(statistics.bufferUnderruns, std::memory_order_relaxed);
+    m_failedPackets.store(statistics.failedPackets, std::memory_order_relaxed);
+    m_resendRequests.store(statistics.resendRequests, std::memory_order_relaxed);
+    m_resentPackets.store(statistics.resentPackets, std::memory_order_relaxed);
+    m_clockSyncFailures.store(statistics.clockSyncFailures, std::memory_order_relaxed);
+}
+
+std::unique_ptr<link_dev::basler::CameraTelemetryT> CameraTelemetry::collect(double intervalSeconds)
+{
+    std::unique_ptr<link_dev::basler::CameraTelemetryT> telemetry(new link_dev::basler::CameraTelemetryT());
+
+    telemetry->serial_number = m_serialNumber;
+    telemetry->frames = m_frames.exchange(0, std::memory_order_relaxed);
+    telemetry->fps = intervalSeconds > 0.0 ? (float) (telemetry->frames / intervalSeconds) : 0.0f;
+    telemetry->skipped_images = m_skippedImages.exchange(0, std::memory_order_relaxed);
+    telemetry->id_gaps = m_idGaps.exchange(0, std::memory_order_relaxed);
+
+    for(size_t i = 0; i < TELEMETRY_ERROR_CODE_SLOTS; i++)
+    {
+        uint64_t count = m_errorCounts[i].exchange(0, std::memory_order_relaxed);
+        if(count > 0)
+        {
+            std::unique_ptr<link_dev::basler::ErrorCountT> errorCount(new link_dev::basler::ErrorCountT());
+            errorCount->code = m_errorCodes[i].load(std::memory_order_relaxed);
+            errorCount->count = count;
+            telemetry->grab_errors.push_back(std::move(errorCount));
+        }
+    }
+    uint64_t otherErrors = m_otherErrors.exchange(0, std::memory_order_relaxed);
+    if(otherErrors > 0)
+    {
+        // Codes that found no free slot are reported together under code 0.
+        std::unique_ptr<link_dev::basler::ErrorCountT> errorCount(new link_dev::basler::ErrorCountT());
+        errorCount->code = 0;
+        errorCount->count = otherErrors;
+        telemetry->grab_errors.push_back(std::move(errorCount));
+    }
+
+    telemetry->convert_queue_drops = m_convertQueueDrops.load(std::memory_order_relaxed);
+    telemetry->publish_queue_drops = m_publishQueueDrops.load(std::memory_order_relaxed);
+    telemetry->ready_buffers = m_readyBuffers.load(std::memory_order_relaxed);
+    telemetry->queued_buffers = m_queuedBuffers.load(std::memory_order_relaxed);
+    telemetry->convert_queue_depth = m_convertQueueDepth.load(std::memory_order_relaxed);
+    telemetry->publish_queue_depth = m_publishQueueDepth.load(std::memory_order_relaxed);
+
+    telemetry->failed_buffers = m_failedBuffers.load(std::memory_order_relaxed);
+    telemetry->buffer_underruns = m_bufferUnderruns.load(std::memory_order_relaxed);
+    telemetry->failed_packets = m_failedPackets.load(std::memory_order_relaxed);
+    telemetry->resend_requests = m_resendRequests.load(std::memory_order_relaxed);
+    telemetry->resent_packets = m_resentPackets.load(std::memory_order_relaxed);
+    telemetry->clock_sync_failures = m_clockSyncFailures.load(std::memory_order_relaxed);
+
+    int64_t disconnectTime = m_disconnectTime.load(std::memory_order_relaxed);
+    uint64_t outageNs = m_outageNs.load(std::memory_order_relaxed);
+    if(disconnectTime != 0)
+    {
+        outageNs += (uint64_t) (steadyClockNs() - disconnectTime);
+    }
+    telemetry->connected = disconnectTime == 0;
+    telemetry->disconnects = m_disconnects.load(std::memory_order_relaxed);
+    telemetry->reconnects = m_reconnects.load(std::memory_order_relaxed);
+    telemetry->outage_ms = outageNs / 1000000;
+    telemetry->last_outage_ms = m_lastOutageNs.load(std::memory_order_relaxed) / 1000000;
+
+    for(size_t stage = 0; stage < (size_t) TelemetryStage::Count; stage++)
+    {
+        LatencyHistogram::Summary summary = m_latencies[stage].snapshotAndReset();
+
+        std::unique_ptr<link_dev::basler::StageLatencyT> latency(new link_dev::basler::StageLatencyT());
+        latency->stage = telemetryStageName((TelemetryStage) stage);
+        latency->p50_us = summary.p50Us;
+        latency->p99_us = summary.p99Us;
+        latency->max_us = summary.maxUs;
+        telemetry->latencies.push_back(std::move(latency));
+    }
+
+    m_gaugesRequested.store(true, std::memory_order_relaxed);
+    return telemetry;
+}
@@ -0,0 +1,159 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "framepipeline.h"
+#include "Telemetry_generated.h"
+
+#define DEFAULT_TELEMETRY_INTERVAL_MS 1000
+#define TELEMETRY_ERROR_CODE_SLOTS 8
+// Eight buckets per power of two keep every percentile within 12.5% of the true value.
+#define LATENCY_HISTOGRAM_SUB_BUCKETS 8
+#define LATENCY_HISTOGRAM_BUCKETS 240
+
+inline int64_t steadyClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+enum class TelemetryStage
+{
+    Queue,
+    Convert,
+    Handoff,
+    Publish,
+    Total,
+    Count
+};
+
+const char* telemetryStageName(TelemetryStage stage);
+
+// Counters of a GigE stream grabber, totals since the camera was opened.
+struct TransportStatistics
+{
+    uint64_t failedBuffers = 0;
+    uint64_t bufferUnderruns = 0;
+    uint64_t failedPackets = 0;
+    uint64_t resendRequests = 0;
+    uint64_t resentPackets = 0;
+    // Not the network, but counted by the source the same way.
+    uint64_t clockSyncFailures = 0;
+};
+
+/*
+    Log-linear histogram of microsecond latencies. record() is one relaxed atomic increment per
+    bucket and counter, so any number of threads may record while another one takes snapshots.
+    A value recorded during snapshotAndReset() ends up in either the old or the new interval.
+*/
+class LatencyHistogram
+{
+public:
+    struct Summary
+    {
+        uint64_t count = 0;
+        float p50Us = 0.0f;
+        float p99Us = 0.0f;
+        float maxUs = 0.0f;
+    };
+
+    LatencyHistogram();
+
+    void record(int64_t latencyNs);
+    Summary snapshotAndReset();
+
+private:
+    static size_t bucketOf(uint64_t latencyUs);
+    static float valueOf(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> m_buckets;
+    std::atomic<uint64_t> m_maxUs;
+};
+
+/*
+    Everything the telemetry offer reports about one camera. The grab thread and the pipeline
+    threads write to it on every frame, the telemetry thread of BaslerCamDriver collects it
+    once per interval. None of the calls take a lock.
+*/
+class CameraTelemetry
+{
+public:
+    explicit CameraTelemetry(const std::string& serialNumber);
+
+    // From the grab thread, for every grab result.
+    void recordGrabResult(int64_t grabId, uint64_t skippedImages);
+    void recordGrabError(uint32_t errorCode);
+    // Around FrameSource::reconnect().
+    void recordDisconnect();
+    void recordReconnect();
+    // After the source stopped and started grabbing again for a control parameter.
+    void recordRestart();
+
+    // From whichever thread pushed the frame, right after the push returned.
+    void recordPublished(const FrameInfo& info, int64_t publishEndTime);
+
+    // Buffer and queue gauges are expensive enough (a node map read) that the grab thread only
+    // samples them when the telemetry thread asked for it.
+    bool gaugesRequested()
+    {
+        return m_gaugesRequested.load(std::memory_order_relaxed) &&
+               m_gaugesRequested.exchange(false, std::memory_order_relaxed);
+    }
+    void setGauges(uint32_t readyBuffers, uint32_t queuedBuffers,
+                   uint32_t convertQueueDepth, uint32_t publishQueueDepth,
+                   uint64_t convertQueueDrops, uint64_t publishQueueDrops);
+    void setTransportStatistics(const TransportStatistics& statistics);
+
+    // From the telemetry thread.
+    std::unique_ptr<link_dev::basler::CameraTelemetryT> collect(double intervalSeconds);
+
+private:
+    std::string m_serialNumber;
+    std::array<LatencyHistogram, (size_t) TelemetryStage::Count> m_latencies;
+
+    std::atomic<uint64_t> m_frames;
+    std::atomic<uint64_t> m_skippedImages;
+    std::atomic<uint64_t> m_idGaps;
+    int64_t m_lastGrabId = -1;    // Only touched by the grab thread.
+
+    // A small open table keyed by error code. A slot with code 0 is free.
+    std::array<std::atomic<uint32_t>, TELEMETRY_ERROR_CODE_SLOTS> m_errorCodes;
+    std::array<std::atomic<uint64_t>, TELEMETRY_ERROR_CODE_SLOTS> m_errorCounts;
+    std::atomic<uint64_t> m_otherErrors;
+
+    std::atomic<bool> m_gaugesRequested;
+    std::atomic<uint32_t> m_readyBuffers;
+    std::atomic<uint32_t> m_queuedBuffers;
+    std::atomic<uint32_t> m_convertQueueDepth;
+    std::atomic<uint32_t> m_publishQueueDepth;
+    std::atomic<uint64_t> m_convertQueueDrops;
+    std::atomic<uint64_t> m_publishQueueDrops;
+    std::atomic<uint64_t> m_failedBuffers;
+    std::atomic<uint64_t> m_bufferUnderruns;
+    std::atomic<uint64_t> m_failedPackets;
+    std::atomic<uint64_t> m_resendRequests;
+    std::atomic<uint64_t> m_resentPackets;
+    std::atomic<uint64_t> m_clockSyncFailures;
+
+    // 0 while connected.
+    std::atomic<int64_t> m_disconnectTime;
+    std::atomic<uint64_t> m_disconnects;
+    std::atomic<uint64_t> m_reconnects;
+    std::atomic<uint64_t> m_outageNs;
+    std::atomic<uint64_t> m_lastOutageNs;
+};
+
+#endif
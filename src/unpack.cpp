@@ -0,0 +1,179 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <stdexcept>
+#include <string>
+#include "unpack.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define UNPACK_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define UNPACK_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(UNPACK_X86) && defined(__GNUC__)
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE41
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+
+inline uint16_t unpackPixel(const uint8_t* source, size_t pixel, int shift, int lowMask)
+{
+    const uint8_t* pair = source + 3 * (pixel / 2);
+    if(pixel % 2 == 0)
+    {
+        return (uint16_t) ((pair[0] << shift) | (pair[1] & lowMask));
+    }
+    return (uint16_t) ((pair[2] << shift) | ((pair[1] >> 4) & lowMask));
+}
+
+/*
+    Vectorized kernels. Each one starts at the even pixel firstPixel, unpacks in whole vectors
+    without reading past the packed bytes of lastPixel, and returns the first pixel it did not
+    touch. The byte shuffle puts the shared low bits into the low byte and the high bits into
+    the high byte of every 16 bit lane, the two pixels of a pair then only differ in how far
+    their low bits are shifted.
+*/
+#if defined(UNPACK_X86)
+
+// Lanes of 8 pixels out of 12 bytes, (low bits, high bits) per lane.
+alignas(16) const uint8_t pairShuffle[16] = { 1, 0, 1, 2, 4, 3, 4, 5, 7, 6, 7, 8, 10, 9, 10, 11 };
+
+TARGET_SSE41 size_t unpackSSE41(const uint8_t* source, uint16_t* destination,
+                                size_t firstPixel, size_t lastPixel, int shift, int lowMask)
+{
+    const __m128i shuffle = _mm_load_si128((const __m128i*) pairShuffle);
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    const __m128i mask = _mm_set1_epi16((short) lowMask);
+    size_t packedEnd = Unpacker::packedSize(lastPixel);
+
+    size_t pixel = firstPixel;
+    for(; pixel + 8 <= lastPixel && pixel / 2 * 3 + 16 <= packedEnd; pixel += 8)
+    {
+        __m128i lanes = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (source + pixel / 2 * 3)), shuffle);
+        __m128i high = _mm_sll_epi16(_mm_srli_epi16(lanes, 8), shiftCount);
+        __m128i lowEven = _mm_and_si128(lanes, mask);
+        __m128i lowOdd = _mm_and_si128(_mm_srli_epi16(lanes, 4), mask);
+        _mm_storeu_si128((__m128i*) (destination + pixel), _mm_or_si128(high, _mm_blend_epi16(lowEven, lowOdd, 0xAA)));
+    }
+    return pixel;
+}
+
+TARGET_AVX2 size_t unpackAVX2(const uint8_t* source, uint16_t* destination,
+                              size_t firstPixel, size_t lastPixel, int shift, int lowMask)
+{
+    const __m128i halfShuffle = _mm_load_si128((const __m128i*) pairShuffle);
+    const __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(halfShuffle), halfShuffle, 1);
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    const __m256i mask = _mm256_set1_epi16((short) lowMask);
+    size_t packedEnd = Unpacker::packedSize(lastPixel);
+
+    size_t pixel = firstPixel;
+    for(; pixel + 16 <= lastPixel && pixel / 2 * 3 + 28 <= packedEnd; pixel += 16)
+    {
+        // pshufb does not cross 128 bit lanes, so each lane gets its own 12 bytes.
+        const uint8_t* packed = source + pixel / 2 * 3;
+        __m256i input = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) packed)),
+                                                _mm_loadu_si128((const __m128i*) (packed + 12)), 1);
+        __m256i lanes = _mm256_shuffle_epi8(input, shuffle);
+        __m256i high = _mm256_sll_epi16(_mm256_srli_epi16(lanes, 8), shiftCount);
+        __m256i lowEven = _mm256_and_si256(lanes, mask);
+        __m256i lowOdd = _mm256_and_si256(_mm256_srli_epi16(lanes, 4), mask);
+        _mm256_storeu_si256((__m256i*) (destination + pixel), _mm256_or_si256(high, _mm256_blend_epi16(lowEven, lowOdd, 0xAA)));
+    }
+    return pixel;
+}
+
+#endif
+
+#if defined(UNPACK_NEON)
+
+// vld3 splits 8 pairs into their three bytes, vst2 interleaves the even and odd pixels again.
+size_t unpackNEON(const uint8_t* source, uint16_t* destination,
+                  size_t firstPixel, size_t lastPixel, int shift, int lowMask)
+{
+    const int16x8_t shiftCount = vdupq_n_s16((int16_t) shift);
+    const uint16x8_t mask = vdupq_n_u16((uint16_t) lowMask);
+    size_t packedEnd = Unpacker::packedSize(lastPixel);
+
+    size_t pixel = firstPixel;
+    for(; pixel + 16 <= lastPixel && pixel / 2 * 3 + 24 <= packedEnd; pixel += 16)
+    {
+        uint8x8x3_t input = vld3_u8(source + pixel / 2 * 3);
+        uint16x8_t low = vmovl_u8(input.val[1]);
+        uint16x8x2_t output;
+        output.val[0] = vorrq_u16(vshlq_u16(vmovl_u8(input.val[0]), shiftCount), vandq_u16(low, mask));
+        output.val[1] = vorrq_u16(vshlq_u16(vmovl_u8(input.val[2]), shiftCount), vandq_u16(vshrq_n_u16(low, 4), mask));
+        vst2q_u16(destination + pixel, output);
+    }
+    return pixel;
+}
+
+#endif
+
+} // namespace
+
+Unpacker::Unpacker(uint32_t bitDepth, InstructionSet instructionSet) :
+                   m_bitDepth(bitDepth),
+                   m_instructionSet(instructionSetSupported(instructionSet) ? instructionSet : bestInstructionSet())
+{
+    if(m_bitDepth != 10 && m_bitDepth != 12)
+    {
+        throw std::invalid_argument("Packed pixels have 10 or 12 bits, not " + std::to_string(m_bitDepth));
+    }
+}
+
+void Unpacker::process(const uint8_t* source, uint16_t* destination, size_t firstPixel, size_t lastPixel) const
+{
+    int shift = (int) m_bitDepth - 8;
+    int lowMask = (1 << shift) - 1;
+
+    size_t vectorEnd = firstPixel;
+    switch(m_instructionSet)
+    {
+#if defined(UNPACK_X86)
+        case InstructionSet::AVX2:
+            vectorEnd = unpackAVX2(source, destination, firstPixel, lastPixel, shift, lowMask);
+            break;
+        case InstructionSet::SSE41:
+            vectorEnd = unpackSSE41(source, destination, firstPixel, lastPixel, shift, lowMask);
+            break;
+#endif
+#if defined(UNPACK_NEON)
+        case InstructionSet::NEON:
+            vectorEnd = unpackNEON(source, destination, firstPixel, lastPixel, shift, lowMask);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    for(size_t pixel = vectorEnd; pixel < lastPixel; pixel++)
+    {
+        destination[pixel] = unpackPixel(source, pixel, shift, lowMask);
+    }
+}
+
+void unpackReference(const uint8_t* source, size_t numberOfPixels, uint32_t bitDepth, uint16_t* destination)
+{
+    int shift = (int) bitDepth - 8;
+    int lowMask = (1 << shift) - 1;
+    for(size_t pixel = 0; pixel < numberOfPixels; pixel++)
+    {
+        destination[pixel] = unpackPixel(source, pixel, shift, lowMask);
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef UNPACK_HPP
+#define UNPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "demosaic.h"
+
+/*
+    Unpacks the GigE Vision packed pixel formats (Mono10Packed, Mono12Packed and the Bayer
+    formats of the same name) to one uint16_t per pixel, right aligned. Two pixels share three
+    bytes: the high bits of the first pixel, the low bits of both (first pixel in the low
+    nibble) and the high bits of the second pixel. Rows are packed back to back, so a frame is
+    one run of pixels.
+    The kernel for the instruction set is picked once at construction, all kernels produce the
+    same values as unpackReference().
+*/
+class Unpacker
+{
+public:
+    Unpacker(uint32_t bitDepth, InstructionSet instructionSet = bestInstructionSet());
+
+    // Bytes that many pixels take when packed.
+    static size_t packedSize(size_t numberOfPixels) { return (numberOfPixels * 3 + 1) / 2; }
+
+    // firstPixel must be even, it is where both source and destination start.
+    void process(const uint8_t* source, uint16_t* destination, size_t firstPixel, size_t lastPixel) const;
+
+    uint32_t bitDepth() const { return m_bitDepth; }
+    InstructionSet instructionSet() const { return m_instructionSet; }
+
+private:
+    uint32_t m_bitDepth;
+    InstructionSet m_instructionSet;
+};
+
+void unpackReference(const uint8_t* source, size_t numberOfPixels, uint32_t bitDepth, uint16_t* destination);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+
+#include <iostream>
+#include <sstream>
+#include "workerpool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+std::vector<int> coreListFromString(const std::string& coreList)
+{
+    std::vector<int> cores;
+    std::stringstream ss(coreList);
+    std::string core;
+
+    while(std::getline(ss, core, ','))
+    {
+        if(!core.empty())
+        {
+            cores.push_back(std::stoi(core));
+        }
+    }
+    return cores;
+}
+
+bool pinCurrentThreadToCore(int core)
+{
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << core) != 0;
+#else
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+#endif
+}
+
+WorkerPool::WorkerPool(size_t numberOfThreads, const std::vector<int>& cores) :
+                       m_nextTask(0)
+{
+    for(size_t i = 1; i < numberOfThreads; i++)
+    {
+        int core = cores.empty() ? -1 : cores[(i - 1) % cores.size()];
+        m_workers.push_back(std::thread(&WorkerPool::workerLoop, this, core));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for(std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(size_t numberOfTasks, InvokeFunction invoke, const void* task)
+{
+    if(m_workers.empty() || numberOfTasks < 2)
+    {
+        for(size_t i = 0; i < numberOfTasks; i++)
+        {
+            invoke(task, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_invoke = invoke;
+        m_task = task;
+        m_numberOfTasks = numberOfTasks;
+        m_nextTask.store(0);
+        m_busyWorkers = m_workers.size();
+        m_jobNumber++;
+    }
+    m_jobAvailable.notify_all();
+
+    runTasks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobDone.wait(lock, [this] { return m_busyWorkers == 0; });
+        m_invoke = nullptr;
+        m_task = nullptr;
+        error = m_error;
+        m_error = nullptr;
+    }
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::workerLoop(int core)
+{
+    if(core >= 0 && !pinCurrentThreadToCore(core))
+    {
+        std::cerr << "Could not pin worker thread to core " << core << "." << std::endl;
+    }
+
+    uint64_t lastJob = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this, lastJob] { return m_stopping || m_jobNumber != lastJob; });
+            if(m_stopping)
+            {
+                return;
+            }
+            lastJob = m_jobNumber;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_jobDone.notify_one();
+    }
+}
+
+void WorkerPool::runTasks()
+{
+    for(size_t i = m_nextTask.fetch_add(1); i < m_numberOfTasks; i = m_nextTask.fetch_add(1))
+    {
+        try
+        {
+            m_invoke(m_task, i);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_error)
+            {
+                m_error = std::current_exception();
+            }
+            // The result is lost anyway, skip the remaining tasks.
+            m_nextTask.store(m_numberOfTasks);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of project link.developers/ld-node-camera-basler.
+ * It is copyrighted by the contributors recorded in the version control history of the file,
+ * available from its original location https://gitlab.com/link.developers.beta/ld-node-camera-basler.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ */
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parses a comma separated list of core indices like "2,3,6". An empty string means no pinning.
+std::vector<int> coreListFromString(const std::string& coreList);
+
+// Pins the calling thread to one core. Returns false if the platform refused.
+bool pinCurrentThreadToCore(int core);
+
+/*
+    A fixed set of threads that live as long as the pool, so that splitting up a frame does not
+    cost a thread start per frame. parallelFor() runs tasks 0..n-1 on the workers and on the
+    calling thread and returns once all of them are done. Only one parallelFor() may run at a time.
+    If a task throws, the tasks not yet started are skipped and parallelFor() rethrows the first
+    exception once the others are done.
+*/
+class WorkerPool
+{
+public:
+    // numberOfThreads counts the calling thread, so 1 means no extra threads at all.
+    // The extra threads are pinned to the cores in turn if cores is not empty, the calling
+    // thread is left where it is.
+    WorkerPool(size_t numberOfThreads, const std::vector<int>& cores = std::vector<int>());
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Takes any callable with operator()(size_t). It is only referred to while parallelFor()
+    // runs, so unlike a std::function the captures of a lambda are never copied to the heap.
+    template<typename Task>
+    void parallelFor(size_t numberOfTasks, const Task& task)
+    {
+        run(numberOfTasks, &invokeTask<Task>, &task);
+    }
+
+    size_t numberOfThreads() const { return m_workers.size() + 1; }
+
+private:
+    using InvokeFunction = void (*)(const void*, size_t);
+
+    template<typename Task>
+    static void invokeTask(const void* task, size_t index)
+    {
+        (*static_cast<const Task*>(task))(index);
+    }
+
+    void run(size_t numberOfTasks, InvokeFunction invoke, const void* task);
+    void workerLoop(int core);
+    void runTasks();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobDone;
+    uint64_t m_jobNumber = 0;
+    bool m_stopping = false;
+    size_t m_busyWorkers = 0;
+
+    InvokeFunction m_invoke = nullptr;
+    const void* m_task = nullptr;
+    size_t m_numberOfTasks = 0;
+    std::atomic<size_t> m_nextTask;
+    // The first exception a task threw in the current run.
+    std::exception_ptr m_error;
+};
+
+#endif